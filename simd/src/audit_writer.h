@@ -0,0 +1,647 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/io_uring.h>
+
+#include "lottery_processor.h"
+#include "utils.h"
+
+/*
+ * Minimal io_uring submission/completion ring on top of the raw syscalls (no liburing).
+ * Not thread-safe: a ring belongs to the thread that submits to it.
+ */
+class IoUring {
+public:
+    IoUring() = default;
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring() {
+        release();
+    }
+
+    // Sets up a new ring, replacing the previous one (whose queued entries are dropped)
+    bool Init(unsigned int entries) {
+        release();
+
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0) {
+            return false;
+        }
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap) {
+            m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+        }
+
+        m_sqRing = ::mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sqRing == MAP_FAILED) {
+            return false;
+        }
+        m_cqRing = singleMmap
+            ? m_sqRing
+            : ::mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = ::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (m_cqRing == MAP_FAILED || m_sqes == MAP_FAILED) {
+            return false;
+        }
+
+        char* sq = static_cast<char*>(m_sqRing);
+        m_sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+        m_sqEntries = params.sq_entries;
+        m_sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+
+        char* cq = static_cast<char*>(m_cqRing);
+        m_cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    unsigned int Entries() const {
+        return m_sqEntries;
+    }
+
+    // Next free submission entry, zeroed; the caller must not queue more than Entries() before Submit
+    io_uring_sqe* NextSqe() {
+        const unsigned int index = (m_localTail + m_queued) & m_sqMask;
+        io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + index;
+        std::memset(sqe, 0, sizeof(*sqe));
+        m_sqArray[index] = index;
+        m_queued++;
+        return sqe;
+    }
+
+    // Publishes the queued entries and blocks until waitFor completions are available
+    bool SubmitAndWait(unsigned int waitFor) {
+        m_localTail += m_queued;
+        __atomic_store_n(m_sqTail, m_localTail, __ATOMIC_RELEASE);
+
+        unsigned int toSubmit = m_queued;
+        m_queued = 0;
+        while (true) {
+            int ret = static_cast<int>(::syscall(__NR_io_uring_enter, m_fd, toSubmit, waitFor, IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (ret >= 0) {
+                return true;
+            }
+            if (errno != EINTR) {
+                return false;
+            }
+            toSubmit = 0; // entries consumed before the interruption must not be submitted twice
+        }
+    }
+
+    bool PopCompletion(io_uring_cqe& cqe) {
+        const unsigned int head = *m_cqHead;
+        if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        cqe = m_cqes[head & m_cqMask];
+        __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    void release() {
+        if (m_sqRing != MAP_FAILED) ::munmap(m_sqRing, m_sqRingSize);
+        if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) ::munmap(m_cqRing, m_cqRingSize);
+        if (m_sqes != MAP_FAILED) ::munmap(m_sqes, m_sqesSize);
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+        m_sqRing = m_cqRing = m_sqes = MAP_FAILED;
+        m_localTail = 0;
+        m_queued = 0;
+    }
+
+    int m_fd = -1;
+    void* m_sqRing = MAP_FAILED;
+    void* m_cqRing = MAP_FAILED;
+    void* m_sqes = MAP_FAILED;
+    size_t m_sqRingSize = 0;
+    size_t m_cqRingSize = 0;
+    size_t m_sqesSize = 0;
+
+    unsigned int* m_sqTail = nullptr;
+    unsigned int* m_sqArray = nullptr;
+    unsigned int m_sqMask = 0;
+    unsigned int m_sqEntries = 0;
+    unsigned int m_localTail = 0;
+    unsigned int m_queued = 0;
+
+    unsigned int* m_cqHead = nullptr;
+    unsigned int* m_cqTail = nullptr;
+    unsigned int m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+};
+
+/*
+ * Durable, append-only log of draw results (audit header + winner list per draw) kept off
+ * the draw path.
+ *
+ * Submit only fills the fixed-size head of one of a fixed set of preallocated requests and
+ * hands the request pointer to a background thread through a single-producer ring; no
+ * allocation or syscall happens unless the writer thread is asleep and has to be woken up
+ * (through a futex, so the draw thread never takes a lock). The winner list is collected
+ * from the dataset by the writer thread (or swapped in, when the caller already has it), so
+ * the draw thread neither scans for winners nor copies them.
+ * The writer serializes up to fsyncBatch requests at a time into page-aligned buffers and
+ * submits their writes plus one fdatasync through io_uring, so draws that arrive together
+ * share the fsync. When io_uring is not available it falls back to pwrite + fdatasync.
+ *
+ * A record holds at most maxWinners player IDs; longer winner lists continue in the
+ * records that follow it (same sequence, part 1..parts-1), so no list is ever cut short.
+ * Records are padded to a multiple of BlockSize, which keeps O_DIRECT writes aligned.
+ * Submit must always be called from the same thread.
+ *
+ * A failed write leaves a gap in the log, so from then on nothing is written or reported
+ * durable: WaitDurable returns false for every later sequence and Submit returns 0 until
+ * the writer is closed and opened again (sequences then restart at 1).
+ */
+class AuditWriter {
+public:
+    static constexpr size_t BlockSize = 4096;
+
+    struct Options {
+        bool directIo = false;      // O_DIRECT: bypass the page cache
+        bool useIoUring = true;     // false uses pwrite + fdatasync
+        size_t slots = 8;           // preallocated requests, i.e. draws in flight
+        size_t maxWinners = 1 << 16; // player IDs per record, longer lists continue in the next records
+        size_t fsyncBatch = 8;      // draws made durable by a single fdatasync at most
+    };
+
+    // Fixed-size head of every record, followed by winnerCount player IDs
+    struct AuditRecord {
+        char magic[8] = {'L', 'O', 'T', 'A', 'U', 'D', 'I', 'T'};
+        uint64_t sequence = 0;      // assigned by Submit, starting at 1
+        uint64_t drawMask = 0;
+        uint64_t epoch = 0;         // dataset epoch the draw was evaluated on
+        int64_t winners[6] = {0, 0, 0, 0, 0, 0};
+        uint32_t winnerCount = 0;   // player IDs in this record
+        uint32_t recordBytes = 0;   // padded size of the whole record
+        uint64_t countUs = 0;
+        uint64_t collectUs = 0;     // set by the writer when it collects the winners
+        uint32_t part = 0;          // position among the records of this draw
+        uint32_t parts = 1;         // consecutive records holding the draw's winner list
+    };
+
+    struct Stats {
+        uint64_t records = 0;       // including the continuation records of long winner lists
+        uint64_t winners = 0;
+        uint64_t bytes = 0;
+        uint64_t fsyncs = 0;
+        uint64_t stalls = 0;        // Submit calls that had to wait for a free request
+    };
+
+    AuditWriter() : AuditWriter(Options()) {}
+    explicit AuditWriter(const Options& options) : m_options(options) {}
+
+    ~AuditWriter() {
+        Close();
+    }
+
+    AuditWriter(const AuditWriter&) = delete;
+    AuditWriter& operator=(const AuditWriter&) = delete;
+
+    // Opens (or appends to) path and starts the writer thread
+    bool Open(const std::string& path) {
+        if (m_fd >= 0 || m_options.slots == 0 || m_options.fsyncBatch == 0 || m_options.maxWinners == 0) {
+            return false;
+        }
+
+        m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | (m_options.directIo ? O_DIRECT : 0), 0644);
+        struct stat st;
+        if (m_fd < 0 || ::fstat(m_fd, &st) != 0) {
+            std::cout << "Error opening " << path << ": " << std::strerror(errno) << std::endl;
+            Close();
+            return false;
+        }
+        m_offset = (static_cast<uint64_t>(st.st_size) + BlockSize - 1) / BlockSize * BlockSize;
+
+        // One buffer per record of a batch; the writer flushes them early when long lists need more
+        m_slotBytes = (sizeof(AuditRecord) + m_options.maxWinners * sizeof(uint64_t) + BlockSize - 1) / BlockSize * BlockSize;
+        m_buffers = static_cast<char*>(std::aligned_alloc(BlockSize, m_slotBytes * m_options.fsyncBatch));
+        if (m_buffers == nullptr) {
+            std::cout << "Error allocating audit buffers" << std::endl;
+            Close();
+            return false;
+        }
+
+        // Fault the buffers in now rather than on the first draws
+        std::memset(m_buffers, 0, m_slotBytes * m_options.fsyncBatch);
+        m_bufferIndex = 0;
+
+        // Both rings start empty, also when a previous Open left entries behind
+        m_requests.assign(m_options.slots, Request());
+        m_submitted.assign(m_options.slots + 1, nullptr);
+        m_submittedTail.store(0);
+        m_submittedHead = 0;
+        m_free.assign(m_options.slots + 1, nullptr);
+        for (size_t i = 0; i < m_options.slots; ++i) {
+            m_free[i] = &m_requests[i];
+        }
+        m_freeHead = 0;
+        m_freeTail = m_options.slots;
+        m_freeTailShared.store(m_freeTail, std::memory_order_release);
+        m_nextSequence = 0;
+        m_durable.store(0);
+        m_failed.store(false);
+        m_sleeping.store(false);
+
+        m_usingIoUring = m_options.useIoUring && m_ring.Init(static_cast<unsigned int>(m_options.fsyncBatch + 1));
+        if (m_options.useIoUring && !m_usingIoUring) {
+            std::cout << "io_uring not available, falling back to pwrite" << std::endl;
+        }
+
+        m_stopping.store(false);
+        m_running.store(true);
+        m_worker = std::thread([this]() {
+            // The draw thread wakes the writer on every Submit; it must not lose the core to it
+            Utils::RunAsBackground();
+            writerLoop();
+        });
+        return true;
+    }
+
+    // Writes out everything submitted so far and stops the writer thread
+    void Close() {
+        if (m_worker.joinable()) {
+            m_stopping.store(true);
+            Utils::FutexWake(m_wakeWord, 1);
+            m_worker.join();
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        std::free(m_buffers);
+        m_buffers = nullptr;
+    }
+
+    /*
+     * Queues a record whose winners (every play of data with at least minMatches matches of
+     * record.drawMask) the writer thread collects, and returns its sequence number, or 0 when
+     * the writer is not open or writing has failed. data must not change until the record is
+     * durable. Blocks only when every request is still in flight.
+     */
+    uint64_t Submit(const AuditRecord& record, const PlayersInfo& data, int minMatches) {
+        Request* request = acquireRequest();
+        if (request == nullptr) {
+            return 0;
+        }
+        request->data = &data;
+        request->minMatches = minMatches;
+        request->winners.clear();
+        return push(request, record);
+    }
+
+    // Same, with a winner list the caller already has; it is swapped in, not copied
+    uint64_t Submit(const AuditRecord& record, std::vector<uint64_t>&& winners) {
+        Request* request = acquireRequest();
+        if (request == nullptr) {
+            return 0;
+        }
+        request->data = nullptr;
+        request->winners.swap(winners);
+        return push(request, record);
+    }
+
+    // Blocks until the record with the given sequence is durable; false if it never will be
+    // (a write failed at or before it, or the writer was closed first)
+    bool WaitDurable(uint64_t sequence) {
+        while (true) {
+            const uint32_t observed = m_durableWord.load();
+            if (m_durable.load() >= sequence) {
+                return true;
+            }
+            if (m_failed.load() || !m_running.load()) {
+                // The last durable store may have landed between the two loads
+                return m_durable.load() >= sequence;
+            }
+            Utils::FutexWait(m_durableWord, observed);
+        }
+    }
+
+    // Highest sequence such that it and every record before it are on stable storage
+    uint64_t DurableSequence() const {
+        return m_durable.load(std::memory_order_acquire);
+    }
+
+    bool UsingIoUring() const {
+        return m_usingIoUring;
+    }
+
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    // One draw in flight: its head plus where its winner list comes from
+    struct Request {
+        AuditRecord head;
+        const PlayersInfo* data = nullptr; // collect from here on the writer thread...
+        int minMatches = 0;
+        std::vector<uint64_t> winners;      // ...or write these
+    };
+
+    size_t next(size_t index) const {
+        return index + 1 == m_options.slots + 1 ? 0 : index + 1;
+    }
+
+    Request* acquireRequest() {
+        if (m_fd < 0 || m_failed.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        bool stalled = false;
+        size_t head = m_freeHead;
+        while (head == m_freeTailShared.load(std::memory_order_acquire)) {
+            stalled = true;
+            std::this_thread::yield();
+        }
+        if (stalled) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.stalls++;
+        }
+
+        Request* request = m_free[head];
+        m_freeHead = next(head);
+        return request;
+    }
+
+    void releaseRequest(Request* request) {
+        m_free[m_freeTail] = request;
+        m_freeTail = next(m_freeTail);
+        m_freeTailShared.store(m_freeTail, std::memory_order_release);
+    }
+
+    uint64_t push(Request* request, const AuditRecord& record) {
+        request->head = record;
+        request->head.sequence = ++m_nextSequence;
+        const uint64_t sequence = request->head.sequence;
+
+        const size_t tail = m_submittedTail.load(std::memory_order_relaxed);
+        m_submitted[tail] = request;
+        m_submittedTail.store(next(tail), std::memory_order_seq_cst);
+
+        // Only pay for the wake-up when the writer is (about to be) asleep
+        if (m_sleeping.load(std::memory_order_seq_cst)) {
+            Utils::FutexWake(m_wakeWord, 1);
+        }
+        return sequence;
+    }
+
+    void writerLoop() {
+        std::vector<Request*> batch;
+        batch.reserve(m_options.fsyncBatch);
+        std::vector<char*> filled;
+        filled.reserve(m_options.fsyncBatch);
+        std::vector<uint64_t> collected;
+        LotteryProcessor collector;
+
+        while (true) {
+            // Drain up to fsyncBatch draws; sleep when there are none
+            batch.clear();
+            while (batch.size() < m_options.fsyncBatch && m_submittedHead != m_submittedTail.load(std::memory_order_acquire)) {
+                batch.emplace_back(m_submitted[m_submittedHead]);
+                m_submittedHead = next(m_submittedHead);
+            }
+
+            if (batch.empty()) {
+                // Announce the sleep before the last look at the ring: Submit either sees the
+                // flag and bumps the futex word, or its record is seen here
+                const uint32_t observed = m_wakeWord.load();
+                m_sleeping.store(true, std::memory_order_seq_cst);
+                const bool idle = m_submittedHead == m_submittedTail.load(std::memory_order_seq_cst);
+                if (idle && m_stopping.load()) {
+                    break;
+                }
+                if (idle) {
+                    Utils::FutexWait(m_wakeWord, observed);
+                }
+                m_sleeping.store(false, std::memory_order_relaxed);
+                continue;
+            }
+
+            // Past a failed write nothing may be reported durable; just hand the requests back
+            if (m_failed.load()) {
+                for (Request* request : batch) {
+                    releaseRequest(request);
+                }
+                continue;
+            }
+
+            /* Explanation: each draw becomes one record per maxWinners player IDs. Records go into
+             * the buffers in order; when the buffers run out in the middle of a long list they are
+             * written (without an fdatasync) and reused. The batch's single fdatasync follows the
+             * last write, so a draw is never reported durable before all of its records are.
+             */
+            uint64_t bytes = 0;
+            uint64_t records = 0;
+            uint64_t winners = 0;
+            bool written = true;
+            filled.clear();
+            const uint64_t lastSequence = batch.back()->head.sequence;
+            for (Request* request : batch) {
+                const std::vector<uint64_t>* list = &request->winners;
+                if (request->data != nullptr) {
+                    auto collectStart = std::chrono::high_resolution_clock::now();
+                    collected.clear();
+                    collector.CollectWinners(*request->data, request->head.drawMask, request->minMatches, collected);
+                    request->head.collectUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::high_resolution_clock::now() - collectStart).count();
+                    list = &collected;
+                }
+
+                const size_t parts = std::max<size_t>(1, (list->size() + m_options.maxWinners - 1) / m_options.maxWinners);
+                for (size_t part = 0; part < parts; ++part) {
+                    if (filled.size() == m_options.fsyncBatch) {
+                        written = writeBatch(filled, false, bytes) && written;
+                        filled.clear();
+                    }
+                    const size_t first = part * m_options.maxWinners;
+                    const size_t count = std::min(m_options.maxWinners, list->size() - first);
+                    filled.emplace_back(serialize(request->head, part, parts, list->data() + first, count));
+                }
+                records += parts;
+                winners += list->size();
+
+                // The request (and the dataset behind it) is no longer needed
+                releaseRequest(request);
+            }
+            written = writeBatch(filled, true, bytes) && written;
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (written) {
+                    m_stats.records += records;
+                    m_stats.winners += winners;
+                    m_stats.bytes += bytes;
+                    m_stats.fsyncs++;
+                }
+            }
+            if (written) {
+                m_durable.store(lastSequence);
+            } else {
+                m_failed.store(true);
+            }
+            Utils::FutexWake(m_durableWord, INT_MAX);
+        }
+
+        m_running.store(false);
+        Utils::FutexWake(m_durableWord, INT_MAX);
+    }
+
+    // Fills the next free buffer with one record (head + count player IDs + padding)
+    char* serialize(const AuditRecord& head, size_t part, size_t parts, const uint64_t* ids, size_t count) {
+        char* buffer = m_buffers + m_bufferIndex * m_slotBytes;
+        m_bufferIndex = m_bufferIndex + 1 == m_options.fsyncBatch ? 0 : m_bufferIndex + 1;
+
+        const size_t bytes = sizeof(AuditRecord) + count * sizeof(uint64_t);
+        AuditRecord* record = reinterpret_cast<AuditRecord*>(buffer);
+        *record = head;
+        record->winnerCount = static_cast<uint32_t>(count);
+        record->recordBytes = static_cast<uint32_t>((bytes + BlockSize - 1) / BlockSize * BlockSize);
+        record->part = static_cast<uint32_t>(part);
+        record->parts = static_cast<uint32_t>(parts);
+        std::memcpy(buffer + sizeof(AuditRecord), ids, count * sizeof(uint64_t));
+        std::memset(buffer + bytes, 0, record->recordBytes - bytes);
+        return buffer;
+    }
+
+    bool writeBatch(const std::vector<char*>& batch, bool sync, uint64_t& bytes) {
+        return m_usingIoUring ? writeBatchIoUring(batch, sync, bytes) : writeBatchPwrite(batch, sync, bytes);
+    }
+
+    // One write per record and, when sync is set, a single fdatasync drained behind them, in one io_uring_enter
+    bool writeBatchIoUring(const std::vector<char*>& batch, bool sync, uint64_t& bytes) {
+        uint64_t batchBytes = 0;
+        for (char* buffer : batch) {
+            const uint32_t size = reinterpret_cast<const AuditRecord*>(buffer)->recordBytes;
+            io_uring_sqe* sqe = m_ring.NextSqe();
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = m_fd;
+            sqe->addr = reinterpret_cast<uint64_t>(buffer);
+            sqe->len = size;
+            sqe->off = m_offset + batchBytes;
+            sqe->user_data = size;
+            batchBytes += size;
+        }
+
+        if (sync) {
+            io_uring_sqe* sqe = m_ring.NextSqe();
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fd = m_fd;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            sqe->flags = IOSQE_IO_DRAIN; // starts only once the writes above completed
+            sqe->user_data = 0;
+        }
+
+        const unsigned int expected = static_cast<unsigned int>(batch.size() + (sync ? 1 : 0));
+        if (expected == 0) {
+            return true;
+        }
+        if (!m_ring.SubmitAndWait(expected)) {
+            std::cout << "Error submitting audit writes: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        bool ok = true;
+        io_uring_cqe cqe;
+        for (unsigned int completed = 0; completed < expected; ) {
+            if (!m_ring.PopCompletion(cqe)) {
+                if (!m_ring.SubmitAndWait(expected - completed)) {
+                    return false;
+                }
+                continue;
+            }
+            completed++;
+
+            // Short writes count as failures: the next record would land at the wrong offset
+            if (cqe.res < 0 || static_cast<uint64_t>(cqe.res) != cqe.user_data) {
+                std::cout << "Error writing audit record: "
+                          << (cqe.res < 0 ? std::strerror(-cqe.res) : "short write") << std::endl;
+                ok = false;
+            }
+        }
+
+        m_offset += batchBytes;
+        bytes += batchBytes;
+        return ok;
+    }
+
+    bool writeBatchPwrite(const std::vector<char*>& batch, bool sync, uint64_t& bytes) {
+        for (char* buffer : batch) {
+            const uint32_t size = reinterpret_cast<const AuditRecord*>(buffer)->recordBytes;
+            if (::pwrite(m_fd, buffer, size, m_offset) != static_cast<ssize_t>(size)) {
+                std::cout << "Error writing audit record: " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            m_offset += size;
+            bytes += size;
+        }
+
+        if (sync && ::fdatasync(m_fd) != 0) {
+            std::cout << "Error syncing audit log: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    Options m_options;
+    int m_fd = -1;
+    uint64_t m_offset = 0;         // writer thread only (after Open)
+    size_t m_slotBytes = 0;
+    char* m_buffers = nullptr;     // fsyncBatch records, writer thread only
+    size_t m_bufferIndex = 0;      // writer thread only
+    IoUring m_ring;
+    bool m_usingIoUring = false;
+    std::vector<Request> m_requests;
+
+    // Draw thread -> writer: submitted requests
+    std::vector<Request*> m_submitted;
+    std::atomic<size_t> m_submittedTail{0};
+    size_t m_submittedHead = 0;     // writer thread only
+
+    // Writer -> draw thread: requests that can be reused
+    std::vector<Request*> m_free;
+    std::atomic<size_t> m_freeTailShared{0};
+    size_t m_freeTail = 0;          // writer thread only
+    size_t m_freeHead = 0;          // draw thread only
+    uint64_t m_nextSequence = 0;    // draw thread only
+
+    std::thread m_worker;
+    mutable std::mutex m_mutex;     // guards m_stats
+    std::atomic<uint32_t> m_wakeWord{0};    // futex the writer sleeps on
+    std::atomic<uint32_t> m_durableWord{0}; // futex WaitDurable sleeps on
+    std::atomic<bool> m_sleeping{false};
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_failed{false};
+    std::atomic<uint64_t> m_durable{0};
+    std::atomic<bool> m_stopping{false};
+    Stats m_stats;
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include "lottery_processor.h"
+#include "utils.h"
+
+/*
+ * Picks the latency-optimal LotteryProcessor::Config (kernel, thread count, chunk size, prefetch distance)
+ * for this machine and the size of the loaded dataset by microbenchmarking every candidate.
+ *
+ * Profiles are persisted as tab separated lines:
+ *   <cpu model> <dataset size bucket> <threads> <chunk size> <kernel> [<prefetch distance>]
+ * where the size bucket is floor(log2(plays)), so later runs on the same CPU with a
+ * similarly sized dataset skip tuning. Profiles without the prefetch distance (written
+ * before the prefetching kernels existed) load with the default.
+ */
+class Autotuner {
+public:
+    struct Options {
+        size_t warmupRuns = 3;
+        size_t measuredRuns = 25;
+    };
+
+    Autotuner() {}
+
+    explicit Autotuner(const Options& options) : m_options(options) {}
+
+    LotteryProcessor::Config Tune(const PlayersInfo& data) {
+        uint64_t pickedNumMask = 0;
+        Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+
+        LotteryProcessor::Config best;
+        uint64_t bestP50 = UINT64_MAX;
+        for (const auto& candidate : candidates(data.play_mask.size())) {
+            uint64_t p50 = measure(data, pickedNumMask, candidate);
+            if (p50 < bestP50) {
+                bestP50 = p50;
+                best = candidate;
+            }
+        }
+
+        m_lastP50 = bestP50;
+        return best;
+    }
+
+    // Loads the profile for this CPU and dataset size, tuning (and saving) it when missing
+    LotteryProcessor::Config LoadOrTune(const std::string& profilePath, const PlayersInfo& data, bool forceTune = false) {
+        LotteryProcessor::Config config;
+        const std::string cpuModel = CpuModel();
+        const size_t bucket = SizeBucket(data.play_mask.size());
+
+        if (!forceTune && LoadProfile(profilePath, cpuModel, bucket, config)) {
+            std::cout << "Loaded tuning profile: " << Describe(config) << std::endl;
+            return config;
+        }
+
+        config = Tune(data);
+        std::cout << "Autotuned: " << Describe(config) << " (p50 " << m_lastP50 << " ns)" << std::endl;
+        if (!SaveProfile(profilePath, cpuModel, bucket, config)) {
+            std::cout << "Error saving tuning profile to " << profilePath << std::endl;
+        }
+        return config;
+    }
+
+    static bool LoadProfile(const std::string& profilePath,
+                            const std::string& cpuModel,
+                            size_t bucket,
+                            LotteryProcessor::Config& config) {
+        std::ifstream ifs(profilePath);
+        std::string line;
+        while (std::getline(ifs, line)) {
+            std::vector<std::string> fields = split(line);
+            if (fields.size() < 5 || fields.size() > 6 || fields[0] != cpuModel || fields[1] != std::to_string(bucket)) {
+                continue;
+            }
+
+            try {
+                LotteryProcessor::Config loaded;
+                loaded.threads = std::stoul(fields[2]);
+                loaded.chunkSize = std::stoull(fields[3]);
+                if (!LotteryProcessor::ParseKernel(fields[4], loaded.kernel)) {
+                    continue;
+                }
+                if (fields.size() == 6) {
+                    loaded.prefetchDistance = std::stoull(fields[5]);
+                }
+                config = loaded;
+                return true;
+            } catch (const std::exception&) {
+                continue;
+            }
+        }
+
+        return false;
+    }
+
+    static bool SaveProfile(const std::string& profilePath,
+                            const std::string& cpuModel,
+                            size_t bucket,
+                            const LotteryProcessor::Config& config) {
+        // Keep the entries of other CPUs / dataset sizes, replace ours
+        std::vector<std::string> lines;
+        {
+            std::ifstream ifs(profilePath);
+            std::string line;
+            while (std::getline(ifs, line)) {
+                std::vector<std::string> fields = split(line);
+                if (fields.size() >= 2 && fields[0] == cpuModel && fields[1] == std::to_string(bucket)) {
+                    continue;
+                }
+                lines.emplace_back(line);
+            }
+        }
+
+        std::ofstream ofs(profilePath, std::ios::trunc);
+        if (!ofs.is_open()) {
+            return false;
+        }
+
+        for (const auto& line : lines) {
+            ofs << line << "\n";
+        }
+        ofs << cpuModel << "\t" << bucket << "\t" << config.threads << "\t" << config.chunkSize << "\t"
+            << LotteryProcessor::KernelName(config.kernel) << "\t" << config.prefetchDistance << "\n";
+        return ofs.good();
+    }
+
+    static std::string CpuModel() {
+        std::ifstream ifs("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(ifs, line)) {
+            if (line.compare(0, 10, "model name") == 0) {
+                size_t colon = line.find(':');
+                if (colon != std::string::npos) {
+                    size_t begin = line.find_first_not_of(' ', colon + 1);
+                    return begin == std::string::npos ? "unknown" : line.substr(begin);
+                }
+            }
+        }
+        return "unknown";
+    }
+
+    // Number of distinct physical cores, i.e. hardware threads minus SMT siblings
+    static unsigned int PhysicalCores() {
+        const unsigned int logical = std::max(1u, std::thread::hardware_concurrency());
+        std::set<std::string> cores;
+        for (unsigned int cpu = 0; cpu < logical; ++cpu) {
+            std::ifstream ifs("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list");
+            std::string siblings;
+            if (!std::getline(ifs, siblings)) {
+                return logical;
+            }
+            cores.insert(siblings);
+        }
+        return std::max<unsigned int>(1, cores.size());
+    }
+
+    static size_t SizeBucket(size_t plays) {
+        size_t bucket = 0;
+        while (plays > 1) {
+            plays >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    static std::string Describe(const LotteryProcessor::Config& config) {
+        std::ostringstream oss;
+        oss << "threads=" << config.threads << " chunk=" << config.chunkSize
+            << " kernel=" << LotteryProcessor::KernelName(config.kernel);
+        if (usesPrefetch(config.kernel)) {
+            oss << " prefetch=" << config.prefetchDistance;
+        }
+        return oss.str();
+    }
+
+private:
+    static bool usesPrefetch(LotteryProcessor::Kernel kernel) {
+        return kernel == LotteryProcessor::Kernel::Avx2Prefetch || kernel == LotteryProcessor::Kernel::Avx2Stream;
+    }
+
+    std::vector<LotteryProcessor::Config> candidates(size_t dataSize) const {
+        const unsigned int logical = std::max(1u, std::thread::hardware_concurrency());
+
+        // Powers of two up to the core count, plus the physical and logical core counts
+        std::set<unsigned int> threadCounts = {logical, PhysicalCores()};
+        for (unsigned int t = 1; t < logical; t <<= 1) {
+            threadCounts.insert(t);
+        }
+
+        // 0 is the static split; dynamic chunks only make sense when smaller than the dataset
+        std::vector<size_t> chunkSizes = {0};
+        for (size_t chunkSize : {16 * 1024, 64 * 1024, 256 * 1024}) {
+            if (chunkSize < dataSize) {
+                chunkSizes.emplace_back(chunkSize);
+            }
+        }
+
+        std::vector<LotteryProcessor::Config> result;
+        for (auto kernel : LotteryProcessor::Kernels) {
+            // Only the prefetching kernels depend on the distance
+            std::vector<size_t> distances = {LotteryProcessor::Config().prefetchDistance};
+            if (usesPrefetch(kernel)) {
+                distances = {128, 512, 2048};
+            }
+
+            for (unsigned int threads : threadCounts) {
+                for (size_t chunkSize : chunkSizes) {
+                    if (threads == 1 && chunkSize != 0) {
+                        continue; // a single inline thread ignores the chunk size
+                    }
+                    for (size_t distance : distances) {
+                        LotteryProcessor::Config config;
+                        config.threads = threads;
+                        config.chunkSize = chunkSize;
+                        config.kernel = kernel;
+                        config.prefetchDistance = distance;
+                        result.emplace_back(config);
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    // Returns the p50 latency in nanoseconds of Count with the given configuration
+    uint64_t measure(const PlayersInfo& data, const uint64_t pickedNumMask, const LotteryProcessor::Config& config) const {
+        LotteryProcessor lp(config);
+        for (size_t i = 0; i < m_options.warmupRuns; ++i) {
+            lp.Count(data, pickedNumMask);
+        }
+
+        std::vector<uint64_t> perfTimes;
+        for (size_t i = 0; i < m_options.measuredRuns; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            lp.Count(data, pickedNumMask);
+            auto end = std::chrono::high_resolution_clock::now();
+            perfTimes.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+
+        std::sort(perfTimes.begin(), perfTimes.end());
+        return perfTimes[perfTimes.size() * 50 / 100];
+    }
+
+    static std::vector<std::string> split(const std::string& line) {
+        std::vector<std::string> fields;
+        std::istringstream iss(line);
+        std::string field;
+        while (std::getline(iss, field, '\t')) {
+            fields.emplace_back(field);
+        }
+        return fields;
+    }
+
+    Options m_options;
+    uint64_t m_lastP50 = 0;
+};
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <random>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+#include "lottery_processor.h"
+#include "utils.h"
+
+/*
+ * Draw evaluation under a deadline: when a full sweep of play_mask does not fit the budget,
+ * Process returns extrapolated tier counts with confidence intervals and delivers the exact
+ * histogram later through a future.
+ *
+ * Plays are split into fixed-size blocks that are scanned in a random order precomputed at
+ * construction, so any prefix of the order is a uniform sample of blocks (cluster sampling
+ * without replacement). Plain plays and system tickets are sampled as two strata, each
+ * at the same pace; the partial last block of each stratum is always counted exactly.
+ *
+ * After the deadline Process only queues the draw's exact pass for a worker thread that lives
+ * as long as this object, so neither a join nor a thread spawn lands on the timed path. Exact
+ * passes run in draw order; the sampling of the next draw does not wait for them. The worker
+ * runs under SCHED_BATCH, so waking it never preempts the thread waiting for the estimate.
+ *
+ * The dataset must not change while a draw is in flight, i.e. until its exact result is ready.
+ */
+class DeadlineProcessor {
+public:
+    struct Options {
+        size_t blockSize = 4096;        // plays per sampling unit
+        double z = 1.96;                // interval half-width in standard errors (1.96 for ~95%)
+        uint64_t seed = 1;              // block order
+        LotteryProcessor::Config config; // kernel, and threads of the exact pass
+    };
+
+    struct Estimate {
+        LotteryProcessor::DrawResult winners; // extrapolated counts, rounded
+        double low[6] = {0, 0, 0, 0, 0, 0};
+        double high[6] = {0, 0, 0, 0, 0, 0};
+        double sampledFraction = 0;     // share of the blocks scanned before the deadline
+        bool exact = false;             // the whole dataset was scanned in time
+    };
+
+    explicit DeadlineProcessor(const PlayersInfo& data) : DeadlineProcessor(data, Options()) {}
+
+    DeadlineProcessor(const PlayersInfo& data, const Options& options)
+        : m_data(data), m_options(options), m_processor(options.config) {
+        m_options.blockSize = std::max<size_t>(1, m_options.blockSize);
+        buildOrder();
+        m_exactWorker = std::thread([this]() { exactLoop(); });
+    }
+
+    // Finishes the queued exact passes first, so every future gets its value
+    ~DeadlineProcessor() {
+        {
+            std::lock_guard<std::mutex> lock(m_jobsMutex);
+            m_stopping = true;
+        }
+        Utils::FutexWake(m_jobsWord, 1);
+        m_exactWorker.join();
+    }
+
+    DeadlineProcessor(const DeadlineProcessor&) = delete;
+    DeadlineProcessor& operator=(const DeadlineProcessor&) = delete;
+
+    Estimate Process(const uint64_t pickedNumMask,
+                     const std::chrono::microseconds budget,
+                     std::future<LotteryProcessor::DrawResult>& exact) {
+        return Process(pickedNumMask, std::chrono::steady_clock::now() + budget, exact);
+    }
+
+    Estimate Process(const uint64_t pickedNumMask,
+                     const std::chrono::steady_clock::time_point deadline,
+                     std::future<LotteryProcessor::DrawResult>& exact) {
+        if (!Utils::ValidateDrawMask(pickedNumMask)) {
+            std::cout << "Invalid draw mask" << std::endl;
+            std::promise<LotteryProcessor::DrawResult> promise;
+            exact = promise.get_future();
+            promise.set_value(LotteryProcessor::DrawResult());
+            return Estimate();
+        }
+        if (m_data.play_mask.size() != m_strata[Plain].items || m_data.system.play_mask.size() != m_strata[System].items) {
+            // Queued exact passes still walk the old block order
+            waitIdle();
+            buildOrder();
+        }
+
+        std::promise<LotteryProcessor::DrawResult> promise;
+        exact = promise.get_future();
+
+        DrawState state;
+        state.known = m_processor.CountRange(m_data,
+                                             m_strata[Plain].blocks() * m_options.blockSize, m_strata[Plain].items,
+                                             m_strata[System].blocks() * m_options.blockSize, m_strata[System].items,
+                                             pickedNumMask);
+
+        /* Explanation: each step scans the next block of the stratum that is furthest behind,
+         * so both strata are sampled at the same rate. Per-tier block sums and sums of squares
+         * are all the estimator needs.
+         */
+        while (std::chrono::steady_clock::now() < deadline) {
+            int next = -1;
+            double lowestFraction = 1.0;
+            for (int s = 0; s < StrataCount; ++s) {
+                const size_t blocks = m_strata[s].blocks();
+                if (state.scanned[s] < blocks && static_cast<double>(state.scanned[s]) / blocks < lowestFraction) {
+                    lowestFraction = static_cast<double>(state.scanned[s]) / blocks;
+                    next = s;
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+
+            LotteryProcessor::DrawResult block = countBlock(next, m_strata[next].order[state.scanned[next]], pickedNumMask);
+            for (int k = 0; k < 6; ++k) {
+                state.sum[next][k] += block.winners[k];
+                state.sumSquares[next][k] += static_cast<double>(block.winners[k]) * block.winners[k];
+            }
+            state.scanned[next]++;
+        }
+
+        Estimate estimate = estimateFrom(state);
+        if (estimate.exact) {
+            promise.set_value(estimate.winners);
+            return estimate;
+        }
+
+        // Past the deadline: an uncontended lock, a push and a wake-up
+        {
+            std::lock_guard<std::mutex> lock(m_jobsMutex);
+            m_jobs.push_back(ExactJob{state, pickedNumMask, std::move(promise)});
+        }
+        m_queued++;
+        Utils::FutexWake(m_jobsWord, 1);
+        return estimate;
+    }
+
+private:
+    enum Stratum { Plain = 0, System = 1, StrataCount = 2 };
+
+    struct StratumOrder {
+        size_t items = 0;
+        std::vector<uint32_t> order;    // full blocks in scan order
+
+        size_t blocks() const {
+            return order.size();
+        }
+    };
+
+    struct DrawState {
+        LotteryProcessor::DrawResult known; // partial last blocks, counted exactly
+        size_t scanned[StrataCount] = {0, 0};
+        double sum[StrataCount][6] = {};
+        double sumSquares[StrataCount][6] = {};
+    };
+
+    struct ExactJob {
+        DrawState state;
+        uint64_t pickedNumMask = 0;
+        std::promise<LotteryProcessor::DrawResult> promise;
+    };
+
+    // Below this many hits in a stratum's sample, the tier's interval uses the Poisson bound
+    static constexpr double RareHits = 10;
+
+    void exactLoop() {
+        Utils::RunAsBackground();
+
+        std::vector<ExactJob> jobs;
+        while (true) {
+            const uint32_t observed = m_jobsWord.load();
+            bool stopping;
+            {
+                std::lock_guard<std::mutex> lock(m_jobsMutex);
+                jobs.swap(m_jobs);
+                stopping = m_stopping;
+            }
+
+            if (jobs.empty()) {
+                if (stopping) {
+                    break;
+                }
+                Utils::FutexWait(m_jobsWord, observed);
+                continue;
+            }
+
+            for (auto& job : jobs) {
+                job.promise.set_value(finishScan(job.state, job.pickedNumMask));
+                Utils::FutexWake(m_finished, INT_MAX);
+            }
+            jobs.clear();
+        }
+    }
+
+    // Waits until every queued exact pass is done
+    void waitIdle() {
+        while (true) {
+            const uint32_t finished = m_finished.load();
+            if (finished == m_queued) {
+                return;
+            }
+            Utils::FutexWait(m_finished, finished);
+        }
+    }
+
+    // Most combinations a single system ticket adds to tier k
+    static double maxSystemWeight(int k) {
+        int weight = 1;
+        for (size_t n = Utils::MinSystemPick; n <= Utils::MaxSystemPick; ++n) {
+            for (int m = 0; m <= 5; ++m) {
+                weight = std::max(weight, SystemTiers.count[n][m][k]);
+            }
+        }
+        return weight;
+    }
+
+    void buildOrder() {
+        std::mt19937_64 rng(m_options.seed);
+        const size_t sizes[StrataCount] = {m_data.play_mask.size(), m_data.system.play_mask.size()};
+        for (int s = 0; s < StrataCount; ++s) {
+            m_strata[s].items = sizes[s];
+            m_strata[s].order.resize(sizes[s] / m_options.blockSize);
+            for (size_t b = 0; b < m_strata[s].order.size(); ++b) {
+                m_strata[s].order[b] = static_cast<uint32_t>(b);
+            }
+            std::shuffle(m_strata[s].order.begin(), m_strata[s].order.end(), rng);
+        }
+    }
+
+    LotteryProcessor::DrawResult countBlock(int stratum, size_t block, const uint64_t pickedNumMask) {
+        const size_t start = block * m_options.blockSize;
+        const size_t end = start + m_options.blockSize;
+        return stratum == Plain
+            ? m_processor.CountRange(m_data, start, end, 0, 0, pickedNumMask)
+            : m_processor.CountRange(m_data, 0, 0, start, end, pickedNumMask);
+    }
+
+    /*
+     * Per stratum with B blocks of which n were scanned: total = B * mean of the block sums,
+     * with variance B^2 * (1 - n/B) * s^2 / n (s^2 the sample variance of the block sums).
+     * Stratum totals and variances add up. With fewer than two blocks scanned the variance is
+     * unknown and the interval falls back to what the unscanned plays could possibly add.
+     *
+     * Rare tiers (4-5 matches) often have no hits in the sample, and then s^2 = 0 would give a
+     * [0, 0] interval. When a stratum's sample holds fewer than RareHits hits x, its share of the
+     * half-width is instead the Poisson upper bound (sqrt(x + 1) + z/2)^2 (3.9 for x = 0 at 95%,
+     * a rule-of-three style bound) minus x, scaled from the n scanned to the B - n unscanned
+     * blocks. System hits are counted in tickets, each adding at most maxSystemWeight(k).
+     */
+    Estimate estimateFrom(const DrawState& state) const {
+        Estimate estimate;
+        size_t scannedBlocks = 0;
+        size_t totalBlocks = 0;
+        double capacity = 0;            // most any tier can still grow by
+        bool varianceKnown = true;
+        double total[6];
+        double squaredHalfWidth[6] = {0, 0, 0, 0, 0, 0};
+        double known[6];
+        for (int k = 0; k < 6; ++k) {
+            known[k] = total[k] = state.known.winners[k];
+        }
+
+        for (int s = 0; s < StrataCount; ++s) {
+            const double blocks = static_cast<double>(m_strata[s].blocks());
+            const double n = static_cast<double>(state.scanned[s]);
+            scannedBlocks += state.scanned[s];
+            totalBlocks += m_strata[s].blocks();
+            if (state.scanned[s] == m_strata[s].blocks()) {
+                for (int k = 0; k < 6; ++k) {
+                    total[k] += state.sum[s][k];
+                    known[k] += state.sum[s][k];
+                }
+                continue;
+            }
+
+            // A system ticket covers at most C(10,5) combinations
+            const double weight = s == Plain ? 1.0 : Utils::Binomial(Utils::MaxSystemPick, 5);
+            capacity += (blocks - n) * m_options.blockSize * weight;
+            varianceKnown = varianceKnown && state.scanned[s] >= 2;
+
+            for (int k = 0; k < 6; ++k) {
+                known[k] += state.sum[s][k];
+                if (n == 0) {
+                    continue;
+                }
+                const double mean = state.sum[s][k] / n;
+                total[k] += blocks * mean;
+                if (n < 2) {
+                    continue;
+                }
+
+                const double hitWeight = s == Plain ? 1.0 : maxSystemWeight(k);
+                const double hits = state.sum[s][k] / hitWeight;
+                if (hits < RareHits) {
+                    const double upper = std::pow(std::sqrt(hits + 1) + m_options.z / 2, 2);
+                    const double halfWidth = (upper - hits) * hitWeight * (blocks - n) / n;
+                    squaredHalfWidth[k] += halfWidth * halfWidth;
+                } else {
+                    const double sampleVariance = std::max(0.0, (state.sumSquares[s][k] - n * mean * mean) / (n - 1));
+                    const double variance = blocks * blocks * (1.0 - n / blocks) * sampleVariance / n;
+                    squaredHalfWidth[k] += m_options.z * m_options.z * variance;
+                }
+            }
+        }
+
+        estimate.exact = scannedBlocks == totalBlocks;
+        estimate.sampledFraction = totalBlocks == 0 ? 1.0 : static_cast<double>(scannedBlocks) / totalBlocks;
+        for (int k = 0; k < 6; ++k) {
+            // Whatever was counted is certain; extrapolation can only add within the capacity
+            total[k] = std::min(std::max(total[k], known[k]), known[k] + capacity);
+            estimate.winners.winners[k] = std::llround(total[k]);
+            if (estimate.exact || !varianceKnown) {
+                estimate.low[k] = estimate.exact ? total[k] : known[k];
+                estimate.high[k] = estimate.exact ? total[k] : known[k] + capacity;
+                continue;
+            }
+            const double halfWidth = std::sqrt(squaredHalfWidth[k]);
+            estimate.low[k] = std::max(known[k], total[k] - halfWidth);
+            estimate.high[k] = std::min(known[k] + capacity, total[k] + halfWidth);
+        }
+        return estimate;
+    }
+
+    // Scans the blocks left after the deadline on config.threads threads and adds everything up
+    LotteryProcessor::DrawResult finishScan(const DrawState& state, const uint64_t pickedNumMask) {
+        std::vector<std::pair<int, size_t>> remaining;
+        for (int s = 0; s < StrataCount; ++s) {
+            for (size_t i = state.scanned[s]; i < m_strata[s].blocks(); ++i) {
+                remaining.emplace_back(s, m_strata[s].order[i]);
+            }
+        }
+
+        const unsigned int numThreads = m_options.config.threads != 0
+            ? m_options.config.threads
+            : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<LotteryProcessor::Counter> counters(numThreads);
+        auto scan = [&](unsigned int t) {
+            for (size_t i = t; i < remaining.size(); i += numThreads) {
+                LotteryProcessor::DrawResult block = countBlock(remaining[i].first, remaining[i].second, pickedNumMask);
+                for (int k = 0; k < 6; ++k) {
+                    counters[t].winners[k] += block.winners[k];
+                }
+            }
+        };
+
+        // The worker scans on its own when single-threaded; helpers inherit its SCHED_BATCH policy
+        if (numThreads == 1) {
+            scan(0);
+        } else {
+            std::vector<std::thread> threads;
+            for (unsigned int t = 0; t < numThreads; ++t) {
+                threads.emplace_back(scan, t);
+            }
+            for (auto &th: threads) th.join();
+        }
+
+        LotteryProcessor::DrawResult result = state.known;
+        for (int k = 0; k < 6; ++k) {
+            for (int s = 0; s < StrataCount; ++s) {
+                result.winners[k] += static_cast<int64_t>(state.sum[s][k]);
+            }
+            for (const auto& counter : counters) {
+                result.winners[k] += counter.winners[k];
+            }
+        }
+        return result;
+    }
+
+    const PlayersInfo& m_data;
+    Options m_options;
+    LotteryProcessor m_processor;
+    StratumOrder m_strata[StrataCount];
+
+    std::thread m_exactWorker;
+    std::mutex m_jobsMutex;              // guards m_jobs and m_stopping
+    std::vector<ExactJob> m_jobs;        // exact passes waiting for the worker, in draw order
+    bool m_stopping = false;
+    std::atomic<uint32_t> m_jobsWord{0}; // futex the worker sleeps on
+    std::atomic<uint32_t> m_finished{0}; // exact passes done, also a futex word for waitIdle
+    uint32_t m_queued = 0;               // exact passes queued, draw thread only
+};
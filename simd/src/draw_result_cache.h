@@ -0,0 +1,224 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+#include "lottery_processor.h"
+#include "utils.h"
+
+/*
+ * Fixed-size, direct-mapped cache of draw results keyed by (picked mask, ruleset).
+ * Every entry is tagged with the dataset epoch it was computed for, so an entry
+ * produced before plays were added or removed, or for another dataset, is never served
+ * (epochs are unique within the process, see Utils::NextEpoch).
+ *
+ * Each slot is protected by a sequence counter (seqlock): readers never take a lock,
+ * they copy the slot and treat it as a miss if the sequence changed meanwhile.
+ * Writers claim a slot with a CAS on the sequence and give up if another writer owns it.
+ */
+class DrawResultCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t inserts = 0;
+        uint64_t evictions = 0;
+
+        double HitRate() const {
+            uint64_t lookups = hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+        }
+    };
+
+    explicit DrawResultCache(size_t capacity = 4096) {
+        size_t slots = 1;
+        while (slots < capacity) {
+            slots <<= 1;
+        }
+
+        m_mask = slots - 1;
+        m_slots.reset(new Slot[slots]);
+    }
+
+    bool Lookup(const uint64_t pickedNumMask,
+                const uint64_t ruleset,
+                const uint64_t epoch,
+                LotteryProcessor::DrawResult& result) const {
+        const Slot& slot = m_slots[slotIndex(pickedNumMask, ruleset)];
+
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        // 0 means the slot was never written, odd means a writer is updating it
+        if (sequence == 0 || (sequence & 1) != 0) {
+            m_misses.value.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        uint64_t slotMask = slot.pickedNumMask.load(std::memory_order_relaxed);
+        uint64_t slotRuleset = slot.ruleset.load(std::memory_order_relaxed);
+        uint64_t slotEpoch = slot.epoch.load(std::memory_order_relaxed);
+        LotteryProcessor::DrawResult copy;
+        for (int i = 0; i < 6; ++i) {
+            copy.winners[i] = slot.winners[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence ||
+            slotMask != pickedNumMask || slotRuleset != ruleset || slotEpoch != epoch) {
+            m_misses.value.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        result = copy;
+        m_hits.value.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Insert(const uint64_t pickedNumMask,
+                const uint64_t ruleset,
+                const uint64_t epoch,
+                const LotteryProcessor::DrawResult& result) {
+        Slot& slot = m_slots[slotIndex(pickedNumMask, ruleset)];
+
+        uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) != 0 ||
+            !slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+            // Another writer owns the slot; dropping the insert is fine for a cache
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (sequence != 0 &&
+            (slot.pickedNumMask.load(std::memory_order_relaxed) != pickedNumMask ||
+             slot.ruleset.load(std::memory_order_relaxed) != ruleset ||
+             slot.epoch.load(std::memory_order_relaxed) != epoch)) {
+            m_evictions.value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        slot.pickedNumMask.store(pickedNumMask, std::memory_order_relaxed);
+        slot.ruleset.store(ruleset, std::memory_order_relaxed);
+        slot.epoch.store(epoch, std::memory_order_relaxed);
+        for (int i = 0; i < 6; ++i) {
+            slot.winners[i].store(result.winners[i], std::memory_order_relaxed);
+        }
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        m_inserts.value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Stats GetStats() const {
+        Stats stats;
+        stats.hits = m_hits.value.load(std::memory_order_relaxed);
+        stats.misses = m_misses.value.load(std::memory_order_relaxed);
+        stats.inserts = m_inserts.value.load(std::memory_order_relaxed);
+        stats.evictions = m_evictions.value.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    size_t Capacity() const {
+        return m_mask + 1;
+    }
+
+private:
+    // Two cache lines per slot: 4 x 8 bytes of key/tag + 6 x 8 bytes of histogram
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<uint64_t> pickedNumMask{0};
+        std::atomic<uint64_t> ruleset{0};
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<int64_t> winners[6] = {};
+    };
+
+    // Aligned to avoid false sharing between the statistics counters
+    struct alignas(64) StatCounter {
+        mutable std::atomic<uint64_t> value{0};
+    };
+
+    size_t slotIndex(const uint64_t pickedNumMask, const uint64_t ruleset) const {
+        // murmur3 finalizer, the picked mask only has 5 bits set so it needs mixing
+        uint64_t h = pickedNumMask ^ (ruleset * 0x9e3779b97f4a7c15ULL);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h & m_mask;
+    }
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask = 0;
+    StatCounter m_hits;
+    StatCounter m_misses;
+    StatCounter m_inserts;
+    StatCounter m_evictions;
+};
+
+/*
+ * LotteryProcessor front-end that serves repeated draws (audit re-runs, dashboards,
+ * client retries) from a DrawResultCache and only falls back to the full sweep on a miss.
+ */
+class CachedLotteryProcessor {
+public:
+    explicit CachedLotteryProcessor(size_t capacity = 4096, uint64_t ruleset = 0)
+        : m_cache(capacity), m_ruleset(ruleset) {}
+
+    // Misses run with config, e.g. a tuned profile
+    explicit CachedLotteryProcessor(const LotteryProcessor::Config& config, size_t capacity = 4096, uint64_t ruleset = 0)
+        : m_processor(config), m_cache(capacity), m_ruleset(ruleset) {}
+
+    void SetConfig(const LotteryProcessor::Config& config) {
+        m_processor.SetConfig(config);
+    }
+
+    const LotteryProcessor::Config& GetConfig() const {
+        return m_processor.GetConfig();
+    }
+
+    void Process(const PlayersInfo& data, const std::vector<int>& play) {
+        if (!Utils::ValidatePlay(play)) {
+            std::cout << "One or more of the picked numbers are not correct" << std::endl;
+            return;
+        }
+
+        uint64_t pickedNumMask = 0;
+        Utils::SetPlayToMask(play, pickedNumMask);
+        LotteryProcessor::DrawResult result = Count(data, pickedNumMask);
+
+        // Output results in the format: [2 matches count] [3 matches count] [4 matches count] [5 matches count]
+        std::cout << result.winners[2] << " " << result.winners[3] << " " << result.winners[4] << " " << result.winners[5] << std::endl;
+    }
+
+    LotteryProcessor::DrawResult Count(const PlayersInfo& data, const uint64_t pickedNumMask) {
+        // An unversioned dataset cannot be told apart from any other one
+        if (data.epoch == 0) {
+            return m_processor.Count(data, pickedNumMask);
+        }
+
+        LotteryProcessor::DrawResult result;
+        if (m_cache.Lookup(pickedNumMask, m_ruleset, data.epoch, result)) {
+            return result;
+        }
+
+        result = m_processor.Count(data, pickedNumMask);
+        m_cache.Insert(pickedNumMask, m_ruleset, data.epoch, result);
+        return result;
+    }
+
+    // Winner lists are not cached, this always scans
+    void CollectWinners(const PlayersInfo& data,
+                        const uint64_t pickedNumMask,
+                        const int minMatches,
+                        std::vector<uint64_t>& winners) {
+        m_processor.CollectWinners(data, pickedNumMask, minMatches, winners);
+    }
+
+    DrawResultCache::Stats GetStats() const {
+        return m_cache.GetStats();
+    }
+
+private:
+    LotteryProcessor m_processor;
+    DrawResultCache m_cache;
+    uint64_t m_ruleset;
+};
@@ -0,0 +1,434 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "lottery_processor.h"
+#include "utils.h"
+
+/*
+ * Tier histogram for every one of the C(60,5) possible draws, computed from shared subset
+ * counts instead of one Process sweep per draw.
+ *
+ * Aggregate counts, for every subset S of 1..5 numbers, how many plays contain S
+ * (an up-closure / zeta transform over k-subsets, 31 increments per play). Every play hits
+ * the small 1- to 3-subset tables, so each thread counts those in its own copy; only the
+ * large 4- and 5-subset tables are shared and updated atomically. For a draw D,
+ * summing those counts over the j-subsets of D gives a_j = sum_k C(k, j) * h_k, where
+ * h_k is the number of plays with k matches. Binomial (Moebius) inversion recovers
+ * h_k = sum_{j>=k} (-1)^(j-k) * C(j, k) * a_j, so each draw costs 31 table lookups.
+ *
+ * A system ticket of n numbers stands for its C(n,5) covered plays: each j-subset of its
+ * numbers is contained in C(n-j, 5-j) of them, so it adds that weight instead of 1.
+ *
+ * Subsets are indexed by their colex rank, and draws are enumerated in colex order.
+ */
+class LiabilitySweep {
+public:
+    static constexpr int Numbers = 60;
+    static constexpr int DrawSize = 5;
+
+    struct Options {
+        unsigned int threads = 0;   // 0 means std::thread::hardware_concurrency()
+        size_t topK = 10;           // 0 only writes the records
+        double prizes[6] = {0, 0, 0, 0, 0, 0}; // payout per play with N matches
+        std::string outputPath;     // empty disables the binary output
+    };
+
+    struct DrawLiability {
+        uint64_t drawMask = 0;
+        LotteryProcessor::DrawResult result;
+        double liability = 0;
+    };
+
+    /*
+     * Binary output layout: one FileHeader followed by drawCount Records in colex rank order.
+     * Record i is at offset sizeof(FileHeader) + i * sizeof(Record).
+     */
+    struct Record {
+        uint64_t drawMask = 0;
+        uint64_t winners[4] = {0, 0, 0, 0}; // plays with 2, 3, 4 and 5 matches
+    };
+
+    struct FileHeader {
+        char magic[8] = {'L', 'O', 'T', 'S', 'W', 'E', 'E', 'P'};
+        uint32_t version = 2;       // 2: 64-bit tier counts
+        uint32_t recordSize = sizeof(Record);
+        uint64_t drawCount = 0;
+        uint64_t plays = 0;
+        uint64_t epoch = 0;
+    };
+
+    LiabilitySweep() : LiabilitySweep(Options()) {}
+
+    explicit LiabilitySweep(const Options& options) : m_options(options) {
+        for (int n = 0; n <= Numbers; ++n) {
+            m_binomial[n][0] = 1;
+            for (int k = 1; k <= DrawSize; ++k) {
+                m_binomial[n][k] = n == 0 ? 0 : m_binomial[n - 1][k - 1] + m_binomial[n - 1][k];
+            }
+        }
+
+        for (int j = 1; j <= DrawSize; ++j) {
+            m_subsetCounts[j].assign(m_binomial[Numbers][j], 0);
+        }
+    }
+
+    uint64_t DrawCount() const {
+        return m_binomial[Numbers][DrawSize];
+    }
+
+    // Builds the subset counts of the live plays of data; replaces any previous aggregation
+    void Aggregate(const PlayersInfo& data) {
+        for (int j = 1; j <= DrawSize; ++j) {
+            std::fill(m_subsetCounts[j].begin(), m_subsetCounts[j].end(), 0);
+        }
+        m_plays = 0;
+        m_epoch = data.epoch;
+
+        std::vector<LocalCounts> locals(threadCount());
+        for (auto& local : locals) {
+            for (int j = 1; j <= LocalSizes; ++j) {
+                local.counts[j].assign(m_binomial[Numbers][j], 0);
+            }
+        }
+
+        const size_t dataSize = data.play_mask.size();
+        std::atomic<uint64_t> plays{0};
+        runParallel(dataSize, [&](unsigned int t, size_t start, size_t end) {
+            uint64_t local = 0;
+            for (size_t i = start; i < end; i++) {
+                if (Utils::IsCancelled(data, i)) {
+                    continue;
+                }
+
+                // Plays repeating a number have fewer than 5 distinct numbers (and more never validate)
+                static constexpr uint64_t weights[DrawSize + 1] = {1, 1, 1, 1, 1, 1};
+                int numbers[DrawSize];
+                const int count = toIndices(data.play_mask[i], numbers);
+                addSubsets(numbers, count, weights, locals[t]);
+                local++;
+            }
+            plays.fetch_add(local, std::memory_order_relaxed);
+        });
+
+        const SystemPlaysInfo& system = data.system;
+        runParallel(system.play_mask.size(), [&](unsigned int t, size_t start, size_t end) {
+            uint64_t local = 0;
+            for (size_t i = start; i < end; i++) {
+                if (Utils::IsCancelled(system.tombstone, i)) {
+                    continue;
+                }
+
+                int numbers[Utils::MaxSystemPick];
+                const int count = toIndices(system.play_mask[i], numbers, Utils::MaxSystemPick);
+                uint64_t weights[DrawSize + 1];
+                for (int size = 0; size <= DrawSize; ++size) {
+                    weights[size] = m_binomial[count - size][DrawSize - size];
+                }
+                addSubsets(numbers, count, weights, locals[t]);
+                local += m_binomial[count][DrawSize];
+            }
+            plays.fetch_add(local, std::memory_order_relaxed);
+        });
+
+        for (const auto& local : locals) {
+            for (int j = 1; j <= LocalSizes; ++j) {
+                for (size_t rank = 0; rank < local.counts[j].size(); ++rank) {
+                    m_subsetCounts[j][rank] += local.counts[j][rank];
+                }
+            }
+        }
+        m_plays = plays.load();
+    }
+
+    // Histogram of a single draw from the aggregated counts; empty (and a message) unless drawMask
+    // selects exactly five numbers within 1 to 60
+    LotteryProcessor::DrawResult Evaluate(const uint64_t drawMask) const {
+        int numbers[DrawSize];
+        LotteryProcessor::DrawResult result;
+        if (!Utils::ValidateDrawMask(drawMask) || __builtin_popcountll(drawMask) != DrawSize) {
+            std::cout << "Invalid draw mask" << std::endl;
+            return result;
+        }
+
+        toIndices(drawMask, numbers);
+        evaluate(numbers, result);
+        return result;
+    }
+
+    /*
+     * Evaluates the draws with colex rank in [rankBegin, rankEnd), writes their records to the
+     * output file (if any) and returns the topK draws by liability, highest first.
+     */
+    bool Run(uint64_t rankBegin, uint64_t rankEnd, std::vector<DrawLiability>& top) {
+        rankEnd = std::min(rankEnd, DrawCount());
+        top.clear();
+        if (rankBegin >= rankEnd) {
+            return true;
+        }
+
+        int fd = -1;
+        if (!m_options.outputPath.empty()) {
+            fd = ::open(m_options.outputPath.c_str(), O_WRONLY | O_CREAT, 0644);
+            FileHeader header;
+            header.drawCount = DrawCount();
+            header.plays = m_plays;
+            header.epoch = m_epoch;
+            const off_t fileSize = sizeof(FileHeader) + DrawCount() * sizeof(Record);
+            if (fd < 0 || ::ftruncate(fd, fileSize) != 0 ||
+                ::pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+                std::cout << "Error writing " << m_options.outputPath << ": " << std::strerror(errno) << std::endl;
+                if (fd >= 0) ::close(fd);
+                return false;
+            }
+        }
+
+        /* Explanation: draws are processed in blocks pulled from a shared cursor. Each worker
+         * streams its block to the output file at the block's own offset (records are fixed-size)
+         * and keeps its own top-k heap; heaps are merged once every block is done.
+         */
+        const unsigned int numThreads = threadCount();
+        std::vector<std::vector<DrawLiability>> heaps(numThreads);
+        std::atomic<uint64_t> cursor{rankBegin};
+        std::atomic<bool> failed{false};
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t]() {
+                std::vector<Record> records(BlockSize);
+                uint64_t begin;
+                while ((begin = cursor.fetch_add(BlockSize, std::memory_order_relaxed)) < rankEnd) {
+                    const uint64_t end = std::min<uint64_t>(begin + BlockSize, rankEnd);
+                    sweepBlock(begin, end, records, heaps[t]);
+
+                    if (fd >= 0) {
+                        const size_t bytes = (end - begin) * sizeof(Record);
+                        const off_t offset = sizeof(FileHeader) + begin * sizeof(Record);
+                        if (::pwrite(fd, records.data(), bytes, offset) != static_cast<ssize_t>(bytes)) {
+                            failed = true;
+                        }
+                    }
+                }
+            });
+        }
+
+        for (auto &th: threads) th.join();
+
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (failed) {
+            std::cout << "Error writing " << m_options.outputPath << std::endl;
+            return false;
+        }
+
+        for (const auto& heap : heaps) {
+            top.insert(top.end(), heap.begin(), heap.end());
+        }
+        std::sort(top.begin(), top.end(), [](const DrawLiability& a, const DrawLiability& b) {
+            return a.liability > b.liability;
+        });
+        if (top.size() > m_options.topK) {
+            top.resize(m_options.topK);
+        }
+        return true;
+    }
+
+    bool Run(std::vector<DrawLiability>& top) {
+        return Run(0, DrawCount(), top);
+    }
+
+    // Draw with the given colex rank
+    uint64_t DrawMask(uint64_t rank) const {
+        int numbers[DrawSize];
+        unrank(rank, numbers);
+        return toMask(numbers);
+    }
+
+private:
+    static constexpr uint64_t BlockSize = 16 * 1024;
+
+    // Subset sizes counted per thread: C(60,3) = 34220 counters, a few hundred KiB per thread
+    static constexpr int LocalSizes = 3;
+
+    struct LocalCounts {
+        std::vector<uint64_t> counts[LocalSizes + 1]; // [j][colex rank of a j-subset], j >= 1
+    };
+
+    /*
+     * Adds weights[j] to every j-subset (j = 1..5) of the ascending numbers. The subsets are
+     * walked as nested ascending picks, so each rank is its parent's rank plus C(number, j).
+     */
+    void addSubsets(const int* numbers, int count, const uint64_t weights[DrawSize + 1], LocalCounts& local) {
+        for (int a = 0; a < count; ++a) {
+            const uint64_t rank1 = m_binomial[numbers[a]][1];
+            local.counts[1][rank1] += weights[1];
+            for (int b = a + 1; b < count; ++b) {
+                const uint64_t rank2 = rank1 + m_binomial[numbers[b]][2];
+                local.counts[2][rank2] += weights[2];
+                for (int c = b + 1; c < count; ++c) {
+                    const uint64_t rank3 = rank2 + m_binomial[numbers[c]][3];
+                    local.counts[3][rank3] += weights[3];
+                    for (int d = c + 1; d < count; ++d) {
+                        const uint64_t rank4 = rank3 + m_binomial[numbers[d]][4];
+                        __atomic_fetch_add(&m_subsetCounts[4][rank4], weights[4], __ATOMIC_RELAXED);
+                        for (int e = d + 1; e < count; ++e) {
+                            const uint64_t rank5 = rank4 + m_binomial[numbers[e]][5];
+                            __atomic_fetch_add(&m_subsetCounts[5][rank5], weights[5], __ATOMIC_RELAXED);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned int threadCount() const {
+        return m_options.threads != 0 ? m_options.threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Splits [0, dataSize) in one chunk per thread; work gets the thread index and its chunk
+    void runParallel(size_t dataSize, const std::function<void(unsigned int, size_t, size_t)>& work) const {
+        const unsigned int numThreads = threadCount();
+        std::vector<std::thread> threads;
+        size_t chunk = dataSize / numThreads;
+        for (unsigned int t = 0; t < numThreads; ++t) {
+            size_t start = t * chunk;
+            size_t end = (t+1==numThreads) ? dataSize : start+chunk;
+            threads.emplace_back([&, t, start, end]() { work(t, start, end); });
+        }
+
+        for (auto &th: threads) th.join();
+    }
+
+    void sweepBlock(uint64_t begin, uint64_t end, std::vector<Record>& records, std::vector<DrawLiability>& heap) const {
+        auto cheaper = [](const DrawLiability& a, const DrawLiability& b) { return a.liability > b.liability; };
+
+        int numbers[DrawSize];
+        unrank(begin, numbers);
+        for (uint64_t rank = begin; rank < end; ++rank) {
+            LotteryProcessor::DrawResult result;
+            evaluate(numbers, result);
+
+            Record& record = records[rank - begin];
+            record.drawMask = toMask(numbers);
+            for (int k = 2; k <= DrawSize; ++k) {
+                record.winners[k - 2] = result.winners[k];
+            }
+
+            double liability = 0;
+            for (int k = 0; k <= DrawSize; ++k) {
+                liability += result.winners[k] * m_options.prizes[k];
+            }
+
+            // Min-heap on liability holding the worker's topK most expensive draws
+            if (m_options.topK == 0) {
+                nextCombination(numbers);
+                continue;
+            }
+            if (heap.size() < m_options.topK || liability > heap.front().liability) {
+                DrawLiability entry;
+                entry.drawMask = record.drawMask;
+                entry.result = result;
+                entry.liability = liability;
+                heap.emplace_back(entry);
+                std::push_heap(heap.begin(), heap.end(), cheaper);
+                if (heap.size() > m_options.topK) {
+                    std::pop_heap(heap.begin(), heap.end(), cheaper);
+                    heap.pop_back();
+                }
+            }
+
+            nextCombination(numbers);
+        }
+    }
+
+    void evaluate(const int numbers[DrawSize], LotteryProcessor::DrawResult& result) const {
+        // a[j] = number of (play, j-subset of the draw contained in the play) pairs
+        int64_t a[DrawSize + 1] = {static_cast<int64_t>(m_plays), 0, 0, 0, 0, 0};
+        for (int subset = 1; subset < (1 << DrawSize); ++subset) {
+            int size = 0;
+            uint64_t rank = subsetRank(numbers, subset, size);
+            a[size] += static_cast<int64_t>(m_subsetCounts[size][rank]);
+        }
+
+        for (int k = 0; k <= DrawSize; ++k) {
+            int64_t h = 0;
+            for (int j = k; j <= DrawSize; ++j) {
+                const int64_t term = static_cast<int64_t>(m_binomial[j][k]) * a[j];
+                h += ((j - k) % 2 == 0) ? term : -term;
+            }
+            result.winners[k] = h;
+        }
+    }
+
+    // Colex rank of the numbers selected by the bits of subset (numbers must be ascending)
+    uint64_t subsetRank(const int* numbers, int subset, int& size) const {
+        uint64_t rank = 0;
+        size = 0;
+        for (int i = 0; (subset >> i) != 0; ++i) {
+            if ((subset >> i) & 1) {
+                size++;
+                rank += m_binomial[numbers[i]][size];
+            }
+        }
+        return rank;
+    }
+
+    void unrank(uint64_t rank, int numbers[DrawSize]) const {
+        int candidate = Numbers - 1;
+        for (int i = DrawSize; i >= 1; --i) {
+            while (m_binomial[candidate][i] > rank) {
+                candidate--;
+            }
+            numbers[i - 1] = candidate;
+            rank -= m_binomial[candidate][i];
+            candidate--;
+        }
+    }
+
+    // Advances numbers to the next combination in colex order
+    static void nextCombination(int numbers[DrawSize]) {
+        int i = 0;
+        while (i < DrawSize - 1 && numbers[i] + 1 == numbers[i + 1]) {
+            i++;
+        }
+        numbers[i]++;
+        for (int j = 0; j < i; ++j) {
+            numbers[j] = j;
+        }
+    }
+
+    // Maps the numbers of mask (bits 1..60) to ascending 0-based indices, returns how many (at most maxCount)
+    static int toIndices(uint64_t mask, int* numbers, int maxCount = DrawSize) {
+        int count = 0;
+        while (mask != 0 && count < maxCount) {
+            numbers[count++] = __builtin_ctzll(mask) - 1;
+            mask &= mask - 1;
+        }
+        return count;
+    }
+
+    static uint64_t toMask(const int numbers[DrawSize]) {
+        uint64_t mask = 0;
+        for (int i = 0; i < DrawSize; ++i) {
+            mask |= 1ULL << (numbers[i] + 1);
+        }
+        return mask;
+    }
+
+    Options m_options;
+    uint64_t m_binomial[Numbers + 1][DrawSize + 1] = {};
+    // [j][colex rank of a j-subset]; 64-bit because a system ticket adds up to C(9,4) = 126 per number
+    std::vector<uint64_t> m_subsetCounts[DrawSize + 1];
+    uint64_t m_plays = 0;
+    uint64_t m_epoch = 0;
+};
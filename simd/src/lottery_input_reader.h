@@ -4,8 +4,10 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <tuple>
 
 #include "utils.h"
+#include "play_analytics.h"
 
 class LotteryInputReader {
 public:
@@ -17,7 +19,23 @@ public:
         }
     }
 
-    bool Read() {
+    // Keeps analytics up to date while plays are loaded, so it is ready to query right after Read()
+    void AttachAnalytics(PlayAnalytics* analytics) {
+        m_analytics = analytics;
+    }
+
+    /*
+     * Only keeps the plays of the shardIndex-th of shardCount equal player_id ranges, so a
+     * shard process never holds the rest of the file. player_id is the line number, so the
+     * ranges split lines 1..N of the file (N is counted by a first pass over the file).
+     */
+    void SetShard(size_t shardIndex, size_t shardCount) {
+        m_shardIndex = shardIndex;
+        m_shardCount = shardCount;
+    }
+
+    // announceReady=false lets the caller print READY itself once it is actually ready for draws
+    bool Read(bool announceReady = true) {
         if (!m_fileStream.is_open()) {
             std::cout << "Error opening file" << std::endl;
             return false;
@@ -25,8 +43,28 @@ public:
 
         std::string line;
         uint64_t lineNumber = 0;
+        uint64_t idBegin = 1;
+        uint64_t idEnd = UINT64_MAX;
+
+        if (m_shardCount != 0) {
+            uint64_t lines = 0;
+            while (std::getline(m_fileStream, line)) {
+                lines++;
+            }
+            m_fileStream.clear();
+            m_fileStream.seekg(0);
+            std::tie(idBegin, idEnd) = Utils::ShardIdRange(1, lines, m_shardIndex, m_shardCount);
+        }
 
         while (std::getline(m_fileStream, line)) {
+            if (lineNumber + 1 < idBegin) {
+                lineNumber++;
+                continue;
+            }
+            if (lineNumber + 1 >= idEnd) {
+                break;
+            }
+
             std::istringstream iss(line);
             std::vector<int> row;
             int value;
@@ -41,6 +79,16 @@ public:
                 Utils::SetPlayToMask(row, play.play_mask);
                 m_data.player_id.emplace_back(play.player_id);
                 m_data.play_mask.emplace_back(play.play_mask);
+
+                if (m_analytics != nullptr && m_data.play_mask.size() % AnalyticsBatch == 0) {
+                    m_analytics->Update(m_data);
+                }
+            } else if (Utils::ValidateSystemPlay(row)) {
+                uint64_t mask = 0;
+                Utils::SetPlayToMask(row, mask);
+                m_data.system.player_id.emplace_back(lineNumber + 1);
+                m_data.system.play_mask.emplace_back(mask);
+                m_data.system.pick_count.emplace_back(static_cast<uint8_t>(row.size()));
             } else {
                 std::cout << "Invalid play: " << line << ", ignoring it" << std::endl;
             }
@@ -48,12 +96,21 @@ public:
             lineNumber++;
         }
 
-        if (m_data.player_id.empty()) {
+        // A shard may legitimately be empty when there are more shards than lines
+        if (m_data.player_id.empty() && m_data.system.player_id.empty() && m_shardCount == 0) {
             std::cout << "No data read from file" << std::endl;
             return false;
         }
 
-        std::cout << "READY" << std::endl;
+        if (m_analytics != nullptr) {
+            m_analytics->Update(m_data);
+        }
+
+        m_data.epoch = Utils::NextEpoch();
+
+        if (announceReady) {
+            std::cout << "READY" << std::endl;
+        }
         return true;
     }
 
@@ -62,6 +119,11 @@ public:
     }
 
 private:
+    static constexpr size_t AnalyticsBatch = 1 << 20;
+
     std::ifstream m_fileStream;
     PlayersInfo m_data;
+    PlayAnalytics* m_analytics = nullptr;
+    size_t m_shardIndex = 0;
+    size_t m_shardCount = 0;   // 0 keeps every play
 };
\ No newline at end of file
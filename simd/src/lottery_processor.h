@@ -3,68 +3,303 @@
 #include <iostream>
 #include <vector>
 #include <thread>
+#include <atomic>
+#include <string>
+#include <algorithm>
 #include <immintrin.h>
 
 #include "utils.h"
 
 class LotteryProcessor {
 public:
+    // Matching kernels available to processRange
+    enum class Kernel {
+        Avx2,         // manual AVX2 loads + scalar popcount per lane
+        Scalar,       // plain loop, left to the compiler's auto-vectorizer
+        Avx2Prefetch, // Avx2 plus a software prefetch prefetchDistance plays ahead
+        Avx2Stream,   // Avx2 with non-temporal (cache-bypassing) prefetches and loads
+    };
+
+    static constexpr Kernel Kernels[] = {Kernel::Avx2, Kernel::Scalar, Kernel::Avx2Prefetch, Kernel::Avx2Stream};
+
+    /*
+     * Execution parameters of Count. The defaults reproduce the original behaviour:
+     * one static chunk per hardware thread with the AVX2 kernel.
+     */
+    struct Config {
+        unsigned int threads = 0; // 0 means std::thread::hardware_concurrency()
+        size_t chunkSize = 0;     // plays per work item, 0 means one static chunk per thread
+        Kernel kernel = Kernel::Avx2;
+        size_t prefetchDistance = 512; // plays ahead for Avx2Prefetch and Avx2Stream (512 = 4 KiB)
+    };
+
     LotteryProcessor() {}
 
+    explicit LotteryProcessor(const Config& config) : m_config(config) {}
+
+    void SetConfig(const Config& config) {
+        m_config = config;
+    }
+
+    const Config& GetConfig() const {
+        return m_config;
+    }
+
+    static const char* KernelName(Kernel kernel) {
+        switch (kernel) {
+            case Kernel::Avx2: return "avx2";
+            case Kernel::Scalar: return "scalar";
+            case Kernel::Avx2Prefetch: return "avx2-prefetch";
+            case Kernel::Avx2Stream: return "avx2-stream";
+        }
+        return "unknown";
+    }
+
+    static bool ParseKernel(const std::string& name, Kernel& kernel) {
+        for (Kernel candidate : Kernels) {
+            if (name == KernelName(candidate)) {
+                kernel = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
     // Aligned to avoid false sharing between threads
     struct alignas(64) Counter {
-        int winners[6] = {0, 0, 0, 0, 0, 0};
+        int64_t winners[6] = {0, 0, 0, 0, 0, 0};
+    };
+
+    // Per-draw histogram: winners[N] holds the number of plays with N matches
+    // (a system ticket counts once per covered 5-number combination, up to 252 each, hence 64 bits)
+    struct DrawResult {
+        int64_t winners[6] = {0, 0, 0, 0, 0, 0};
     };
 
     void Process(const PlayersInfo& data, const std::vector<int>& play) {
+        DrawResult result;
+        Process(data, play, result);
+    }
+
+    // Same as above, also handing the histogram back (e.g. to persist it); false if the play is invalid
+    bool Process(const PlayersInfo& data, const std::vector<int>& play, DrawResult& result) {
         if (!Utils::ValidatePlay(play)) {
             std::cout << "One or more of the picked numbers are not correct" << std::endl;
-            return;
+            return false;
         }
 
         uint64_t pickedNumMask = 0;
         Utils::SetPlayToMask(play, pickedNumMask);
-        int winnersCounter[6] = {0, 0, 0, 0, 0, 0};
+        result = Count(data, pickedNumMask);
+
+        // Output results in the format: [2 matches count] [3 matches count] [4 matches count] [5 matches count]
+        std::cout << result.winners[2] << " " << result.winners[3] << " " << result.winners[4] << " " << result.winners[5] << std::endl;
+        return true;
+    }
+
+    // Empty histogram (and a message) when pickedNumMask is not a valid draw, see Utils::ValidateDrawMask
+    DrawResult Count(const PlayersInfo& data, const uint64_t pickedNumMask) {
+        DrawResult result;
+        if (!Utils::ValidateDrawMask(pickedNumMask)) {
+            std::cout << "Invalid draw mask" << std::endl;
+            return result;
+        }
         size_t dataSize = data.player_id.size();
+        size_t systemSize = data.system.player_id.size();
 
         /* Explanation: the matching process is executed in chunks of size N divided by T, 
-         * where N is the total number of plays and T is the number of available threads. 
+         * where N is the total number of plays and T is the number of configured threads. 
          * Each thread performs a bitwise AND operation between the play bitmap and the picked numbers bitmap, 
          * followed by a population count to determine how many numbers match (check processRange method).
+         * When a chunk size is configured, threads instead pull fixed-size chunks from a shared cursor,
+         * which balances the load when some cores are slower (e.g. SMT siblings).
+         * System tickets live in separate arrays and are split statically on top (check processSystemRange method).
          */
-        const unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency());
+        const unsigned int numThreads = m_config.threads != 0
+            ? m_config.threads
+            : std::max(1u, std::thread::hardware_concurrency());
         std::vector<Counter> counters(numThreads);
+
+        // A single thread runs inline: spawning costs more than scanning small datasets
+        if (numThreads == 1) {
+            processRange(data, 0, dataSize, pickedNumMask, counters[0]);
+            processSystemRange(data.system, 0, systemSize, pickedNumMask, counters[0]);
+            std::copy(counters[0].winners, counters[0].winners + 6, result.winners);
+            return result;
+        }
+
         std::vector<std::thread> threads;
+        std::atomic<size_t> cursor{0};
         size_t chunk = dataSize / numThreads;
+        size_t systemChunk = systemSize / numThreads;
         for (unsigned int t = 0; t < numThreads; ++t) {
             size_t start = t * chunk;
             size_t end = (t+1==numThreads) ? dataSize : start+chunk;
-            threads.emplace_back([&, start, end, t]() {
-                processRange(data, start, end, pickedNumMask, counters[t]);
+            size_t systemStart = t * systemChunk;
+            size_t systemEnd = (t+1==numThreads) ? systemSize : systemStart+systemChunk;
+            threads.emplace_back([&, start, end, systemStart, systemEnd, t]() {
+                processSystemRange(data.system, systemStart, systemEnd, pickedNumMask, counters[t]);
+
+                if (m_config.chunkSize == 0) {
+                    processRange(data, start, end, pickedNumMask, counters[t]);
+                    return;
+                }
+
+                size_t begin;
+                while ((begin = cursor.fetch_add(m_config.chunkSize, std::memory_order_relaxed)) < dataSize) {
+                    processRange(data, begin, std::min(begin + m_config.chunkSize, dataSize), pickedNumMask, counters[t]);
+                }
             });
         }
 
         for (auto &th: threads) th.join();
 
         /* Explanation: after all threads complete their execution, their individual counters are aggregated 
-         * into a final winnersCounter array to produce the overall results.
+         * into a final result to produce the overall histogram.
         */
         for (const auto& counter : counters) {
             for (int i = 0; i < 6; ++i) {
-                winnersCounter[i] += counter.winners[i];
+                result.winners[i] += counter.winners[i];
             }
         }
 
-        // Output results in the format: [2 matches count] [3 matches count] [4 matches count] [5 matches count]
-        std::cout << winnersCounter[2] << " " << winnersCounter[3] << " " << winnersCounter[4] << " " << winnersCounter[5] << std::endl;
+        return result;
+    }
+
+    /*
+     * Appends to winners the player_id of every play with at least minMatches matches
+     * (for system tickets: with at least one such covered combination).
+     * Player IDs are appended in ascending order as long as both play arrays are sorted by player_id.
+     */
+    void CollectWinners(const PlayersInfo& data,
+                        const uint64_t pickedNumMask,
+                        const int minMatches,
+                        std::vector<uint64_t>& winners) {
+        const size_t begin = winners.size();
+        const size_t dataSize = data.play_mask.size();
+        for (size_t i = 0; i < dataSize; i++) {
+            if (__builtin_popcountll(data.play_mask[i] & pickedNumMask) >= minMatches &&
+                !Utils::IsCancelled(data, i)) {
+                winners.emplace_back(data.player_id[i]);
+            }
+        }
+
+        const size_t plainEnd = winners.size();
+        const SystemPlaysInfo& system = data.system;
+        for (size_t i = 0; i < system.play_mask.size(); i++) {
+            if (__builtin_popcountll(system.play_mask[i] & pickedNumMask) >= minMatches &&
+                !Utils::IsCancelled(system.tombstone, i)) {
+                winners.emplace_back(system.player_id[i]);
+            }
+        }
+
+        std::inplace_merge(winners.begin() + begin, winners.begin() + plainEnd, winners.end());
+    }
+
+    /*
+     * Histogram of the plays in [start, end) plus the system tickets in [systemStart, systemEnd),
+     * counted on the calling thread (building block for callers that schedule the scan themselves).
+     */
+    DrawResult CountRange(const PlayersInfo& data,
+                          size_t start,
+                          size_t end,
+                          size_t systemStart,
+                          size_t systemEnd,
+                          const uint64_t pickedNumMask) {
+        Counter counter;
+        if (!Utils::ValidateDrawMask(pickedNumMask)) {
+            std::cout << "Invalid draw mask" << std::endl;
+            return DrawResult();
+        }
+        if (start < end) {
+            processRange(data, start, end, pickedNumMask, counter);
+        }
+        processSystemRange(data.system, systemStart, systemEnd, pickedNumMask, counter);
+
+        DrawResult result;
+        std::copy(counter.winners, counter.winners + 6, result.winners);
+        return result;
     }
 
 private:
+    /*
+     * System tickets: the match count m of the whole ticket determines how its covered
+     * combinations spread over the tiers, so each ticket is one popcount plus a table row.
+     * Cancelled tickets add a zero row.
+     */
+    void processSystemRange(const SystemPlaysInfo& system,
+                            size_t start,
+                            size_t end,
+                            const uint64_t pickedNumMask,
+                            Counter& counter) {
+        for (size_t i = start; i < end; i++) {
+            const int matches = __builtin_popcountll(system.play_mask[i] & pickedNumMask);
+            const int live = Utils::IsCancelled(system.tombstone, i) ? 0 : 1;
+            const int* tiers = SystemTiers.count[system.pick_count[i]][matches];
+            for (int k = 0; k < 6; ++k) {
+                counter.winners[k] += tiers[k] * live;
+            }
+        }
+    }
+
     void processRange(const PlayersInfo& data,
                       size_t start,
                       size_t end,
                       const uint64_t pickedNumMask,
                       Counter& counter) {
+        switch (m_config.kernel) {
+            case Kernel::Avx2:
+                processRangeAvx2(data, start, end, pickedNumMask, counter);
+                break;
+            case Kernel::Scalar:
+                processRangeScalar(data, start, end, pickedNumMask, counter);
+                break;
+            case Kernel::Avx2Prefetch:
+                processRangeAvx2Prefetch(data, start, end, pickedNumMask, counter);
+                break;
+            case Kernel::Avx2Stream:
+                processRangeAvx2Stream(data, start, end, pickedNumMask, counter);
+                break;
+        }
+
+        if (data.cancelled != 0) {
+            excludeCancelled(data, start, end, pickedNumMask, counter);
+        }
+    }
+
+    /*
+     * Takes cancelled plays back out of the histogram. The kernels stay untouched: this pass
+     * only reads the tombstone bitmap (1 bit per play, 1/64 of the play_mask bandwidth) and
+     * the play_mask entries of the cancelled plays themselves.
+     */
+    void excludeCancelled(const PlayersInfo& data,
+                          size_t start,
+                          size_t end,
+                          const uint64_t pickedNumMask,
+                          Counter& counter) {
+        end = std::min(end, data.tombstone.size() * 64);
+        for (size_t word = start / 64; word * 64 < end; ++word) {
+            uint64_t bits = data.tombstone[word];
+            if (word == start / 64) {
+                bits &= ~0ULL << (start % 64);
+            }
+            if ((word + 1) * 64 > end) {
+                bits &= ~0ULL >> (64 - end % 64);
+            }
+
+            while (bits != 0) {
+                size_t i = word * 64 + __builtin_ctzll(bits);
+                counter.winners[__builtin_popcountll(data.play_mask[i] & pickedNumMask)]--;
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    void processRangeAvx2(const PlayersInfo& data,
+                          size_t start,
+                          size_t end,
+                          const uint64_t pickedNumMask,
+                          Counter& counter) {
         // AVX2: process 4 x 64-bit masks in parallel
         const size_t vectorSize = 4;
         __m256i pickedVec = _mm256_set1_epi64x(pickedNumMask);
@@ -96,4 +331,86 @@ private:
             counter.winners[matches]++;
         }
     }
+
+    void processRangeScalar(const PlayersInfo& data,
+                            size_t start,
+                            size_t end,
+                            const uint64_t pickedNumMask,
+                            Counter& counter) {
+        // Accumulate into a local copy so the compiler can keep the histogram in registers
+        int64_t winners[6] = {0, 0, 0, 0, 0, 0};
+        for (size_t i = start; i < end; i++) {
+            winners[__builtin_popcountll(data.play_mask[i] & pickedNumMask)]++;
+        }
+
+        for (int i = 0; i < 6; ++i) {
+            counter.winners[i] += winners[i];
+        }
+    }
+
+    static inline void countLanes(__m256i result, Counter& counter) {
+        counter.winners[__builtin_popcountll((uint64_t)_mm256_extract_epi64(result, 0))]++;
+        counter.winners[__builtin_popcountll((uint64_t)_mm256_extract_epi64(result, 1))]++;
+        counter.winners[__builtin_popcountll((uint64_t)_mm256_extract_epi64(result, 2))]++;
+        counter.winners[__builtin_popcountll((uint64_t)_mm256_extract_epi64(result, 3))]++;
+    }
+
+    /*
+     * Same compute as processRangeAvx2, one cache line (8 plays) per iteration, with a prefetch
+     * of the line prefetchDistance plays ahead. The prefetch address is clamped to the range so
+     * it never points past the array.
+     */
+    void processRangeAvx2Prefetch(const PlayersInfo& data,
+                                  size_t start,
+                                  size_t end,
+                                  const uint64_t pickedNumMask,
+                                  Counter& counter) {
+        const uint64_t* masks = data.play_mask.data();
+        const size_t distance = m_config.prefetchDistance;
+        __m256i pickedVec = _mm256_set1_epi64x(pickedNumMask);
+
+        size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            _mm_prefetch(reinterpret_cast<const char*>(masks + std::min(i + distance, end - 1)), _MM_HINT_T0);
+            countLanes(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)&masks[i]), pickedVec), counter);
+            countLanes(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)&masks[i + 4]), pickedVec), counter);
+        }
+
+        for (; i < end; i++) {
+            counter.winners[__builtin_popcountll(masks[i] & pickedNumMask)]++;
+        }
+    }
+
+    /*
+     * Cache-bypassing variant: NTA prefetches and MOVNTDQA loads, so the scan does not evict
+     * the rest of the working set. The loads need 32-byte alignment, so plays before the
+     * first aligned address go through the scalar path. On ordinary write-back memory most
+     * CPUs treat MOVNTDQA as a regular load, leaving the NTA prefetch to do the bypassing.
+     */
+    void processRangeAvx2Stream(const PlayersInfo& data,
+                                size_t start,
+                                size_t end,
+                                const uint64_t pickedNumMask,
+                                Counter& counter) {
+        const uint64_t* masks = data.play_mask.data();
+        const size_t distance = m_config.prefetchDistance;
+        __m256i pickedVec = _mm256_set1_epi64x(pickedNumMask);
+
+        size_t i = start;
+        for (; i < end && (reinterpret_cast<uintptr_t>(masks + i) % 32) != 0; i++) {
+            counter.winners[__builtin_popcountll(masks[i] & pickedNumMask)]++;
+        }
+
+        for (; i + 8 <= end; i += 8) {
+            _mm_prefetch(reinterpret_cast<const char*>(masks + std::min(i + distance, end - 1)), _MM_HINT_NTA);
+            countLanes(_mm256_and_si256(_mm256_stream_load_si256((const __m256i*)&masks[i]), pickedVec), counter);
+            countLanes(_mm256_and_si256(_mm256_stream_load_si256((const __m256i*)&masks[i + 4]), pickedVec), counter);
+        }
+
+        for (; i < end; i++) {
+            counter.winners[__builtin_popcountll(masks[i] & pickedNumMask)]++;
+        }
+    }
+
+    Config m_config;
 };
@@ -1,8 +1,20 @@
 #include <iostream>
 #include <chrono>
+#include <algorithm>
+#include <functional>
+#include <iomanip>
 
 #include "lottery_input_reader.h"
 #include "lottery_processor.h"
+#include "autotuner.h"
+#include "residency.h"
+#include "play_analytics.h"
+#include "liability_sweep.h"
+#include "shard_server.h"
+#include "shard_coordinator.h"
+#include "audit_writer.h"
+#include "deadline_processor.h"
+#include "roofline.h"
 
 void readUserInput(std::vector<std::string>& words) {
     size_t wStart = -1;
@@ -29,44 +41,423 @@ void readUserInput(std::vector<std::string>& words) {
     }
 }
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cout << "Usage: " << argv[0] << " <input_file>" << std::endl;
-        return 1;
-    }
-
-    LotteryInputReader reader(argv[1]);
-    LotteryProcessor processor;
+bool readPlay(std::vector<int>& play) {
     std::vector<std::string> userInput;
-    std::vector<int> play;
-
-    if (!reader.Read()) {
-        std::cout << "Failed to read input file" << std::endl;
-        return 1;
-    }
 
     readUserInput(userInput);
     if (userInput.size() > 5) {
         std::cout << "Please provide exactly five numbers." << std::endl;
-        return 1;
+        return false;
     }
 
-    
     for (const auto& input : userInput) {
         try {
             int num = std::stoi(input);
             play.push_back(num);
         } catch (const std::invalid_argument&) {
             std::cout << "Invalid number: " << input << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct RunOptions {
+    std::string profilePath;
+    bool resident = false;
+    bool analytics = false;
+    std::string auditPath;
+    bool directIo = false;
+    long deadlineUs = -1;  // negative runs the exact Process only
+};
+
+void printAnalytics(const PlayAnalytics& analytics) {
+    std::cout << "Number frequencies:";
+    for (int number = 1; number <= PlayAnalytics::Numbers; ++number) {
+        std::cout << " " << number << ":" << analytics.Frequency(number);
+    }
+    std::cout << std::endl;
+
+    std::vector<std::pair<uint64_t, std::pair<int, int>>> pairs;
+    for (int a = 1; a <= PlayAnalytics::Numbers; ++a) {
+        for (int b = a + 1; b <= PlayAnalytics::Numbers; ++b) {
+            pairs.push_back({analytics.PairCount(a, b), {a, b}});
+        }
+    }
+    std::partial_sort(pairs.begin(), pairs.begin() + 10, pairs.end(), std::greater<>());
+
+    std::cout << "Most common pairs:";
+    for (size_t i = 0; i < 10; ++i) {
+        std::cout << " " << pairs[i].second.first << "-" << pairs[i].second.second << ":" << pairs[i].first;
+    }
+    std::cout << std::endl;
+}
+
+int runDeadline(const PlayersInfo& data, const LotteryProcessor::Config& config, const std::vector<int>& play, long deadlineUs) {
+    if (!Utils::ValidatePlay(play)) {
+        std::cout << "One or more of the picked numbers are not correct" << std::endl;
+        return 1;
+    }
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask(play, pickedNumMask);
+    DeadlineProcessor::Options deadlineOptions;
+    deadlineOptions.config = config;
+    DeadlineProcessor processor(data, deadlineOptions);
+    std::future<LotteryProcessor::DrawResult> exact;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    DeadlineProcessor::Estimate estimate = processor.Process(pickedNumMask, std::chrono::microseconds(deadlineUs), exact);
+    auto estimated = std::chrono::high_resolution_clock::now();
+
+    // Estimate format: [N matches estimate] [low, high] for N = 2..5
+    std::cout << std::fixed << std::setprecision(0);
+    for (int k = 2; k <= 5; ++k) {
+        std::cout << (k > 2 ? " " : "") << estimate.winners.winners[k] << " [" << estimate.low[k] << ", " << estimate.high[k] << "]";
+    }
+    std::cout << std::endl;
+    std::cout << "(estimate after: " << std::chrono::duration_cast<std::chrono::microseconds>(estimated - start).count()
+              << " us, " << std::setprecision(1) << estimate.sampledFraction * 100 << "% sampled)" << std::endl;
+
+    LotteryProcessor::DrawResult result = exact.get();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << result.winners[2] << " " << result.winners[3] << " " << result.winners[4] << " " << result.winners[5] << std::endl;
+    std::cout << "(elapsed time: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us)" << std::endl;
+    return 0;
+}
+
+int runSingle(const std::string& inputFile, const RunOptions& options) {
+    LotteryInputReader reader(inputFile);
+    LotteryProcessor processor;
+    PlayAnalytics analytics;
+    std::vector<int> play;
+
+    if (options.analytics) {
+        reader.AttachAnalytics(&analytics);
+    }
+
+    if (!reader.Read(false)) {
+        std::cout << "Failed to read input file" << std::endl;
+        return 1;
+    }
+
+    if (options.analytics) {
+        printAnalytics(analytics);
+    }
+
+    if (!options.profilePath.empty()) {
+        Autotuner tuner;
+        processor.SetConfig(tuner.LoadOrTune(options.profilePath, reader.GetData()));
+    }
+
+    if (options.resident) {
+        Residency::Report report = Residency::MakeResident(reader.GetData(), processor, Residency::Options());
+        Residency::Print(report);
+
+        // READY promises a resident dataset
+        if (!report.FullyResident()) {
+            std::cout << "Dataset is not fully resident, not accepting draws" << std::endl;
             return 1;
         }
+        if (!report.locked) {
+            std::cout << "Warning: dataset is not locked in memory, its pages may be reclaimed before the first draw" << std::endl;
+        }
+    }
+
+    AuditWriter::Options auditOptions;
+    auditOptions.directIo = options.directIo;
+    AuditWriter audit(auditOptions);
+    if (!options.auditPath.empty() && !audit.Open(options.auditPath)) {
+        return 1;
+    }
+
+    std::cout << "READY" << std::endl;
+
+    if (!readPlay(play)) {
+        return 1;
     }
     
+    if (options.deadlineUs >= 0) {
+        return runDeadline(reader.GetData(), processor.GetConfig(), play, options.deadlineUs);
+    }
+
+    LotteryProcessor::DrawResult result;
     auto start = std::chrono::high_resolution_clock::now();
-    processor.Process(reader.GetData(), play);
+    bool processed = processor.Process(reader.GetData(), play, result);
     auto end = std::chrono::high_resolution_clock::now();
     auto elapsed_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
     std::cout << "(elapsed time: " << elapsed_ms.count() << " us)" << std::endl;
+
+    if (processed && !options.auditPath.empty()) {
+        // Winners of every paying tier (2+ matches) go to the audit log; the writer thread collects them
+        AuditWriter::AuditRecord record;
+        Utils::SetPlayToMask(play, record.drawMask);
+        record.epoch = reader.GetData().epoch;
+        std::copy(result.winners, result.winners + 6, record.winners);
+        record.countUs = elapsed_ms.count();
+
+        uint64_t sequence = audit.Submit(record, reader.GetData(), 2);
+        if (sequence == 0 || !audit.WaitDurable(sequence)) {
+            std::cout << "Failed to write audit record" << std::endl;
+            return 1;
+        }
+        auto durable = std::chrono::high_resolution_clock::now();
+        std::cout << "(durable after: " << std::chrono::duration_cast<std::chrono::microseconds>(durable - start).count()
+                  << " us, " << audit.GetStats().winners << " winners)" << std::endl;
+    }
     
     return 0;
 }
+
+int runAutotune(const std::string& inputFile, const std::string& profilePath) {
+    LotteryInputReader reader(inputFile);
+    if (!reader.Read(false)) {
+        std::cout << "Failed to read input file" << std::endl;
+        return 1;
+    }
+
+    Autotuner tuner;
+    tuner.LoadOrTune(profilePath, reader.GetData(), true);
+    return 0;
+}
+
+int runRoofline(const std::string& inputFile) {
+    LotteryInputReader reader(inputFile);
+    if (!reader.Read(false)) {
+        std::cout << "Failed to read input file" << std::endl;
+        return 1;
+    }
+
+    Roofline roofline;
+    return roofline.Run(reader.GetData()).empty() ? 1 : 0;
+}
+
+int runSweep(const std::string& inputFile, const std::string& outputFile, size_t topK, const std::vector<double>& prizes) {
+    LotteryInputReader reader(inputFile);
+    if (!reader.Read(false)) {
+        std::cout << "Failed to read input file" << std::endl;
+        return 1;
+    }
+
+    LiabilitySweep::Options options;
+    options.topK = topK;
+    options.outputPath = outputFile;
+    for (size_t k = 0; k < prizes.size(); ++k) {
+        options.prizes[k + 2] = prizes[k];
+    }
+
+    LiabilitySweep sweep(options);
+    std::vector<LiabilitySweep::DrawLiability> top;
+    auto start = std::chrono::high_resolution_clock::now();
+    sweep.Aggregate(reader.GetData());
+    if (!sweep.Run(top)) {
+        return 1;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    // Output format: [draw numbers] : [liability] [2 matches count] [3 matches count] [4 matches count] [5 matches count]
+    for (const auto& draw : top) {
+        for (int number = 1; number <= LiabilitySweep::Numbers; ++number) {
+            if ((draw.drawMask >> number) & 1) {
+                std::cout << number << " ";
+            }
+        }
+        std::cout << ": " << std::fixed << std::setprecision(2) << draw.liability << " " << draw.result.winners[2] << " " << draw.result.winners[3]
+                  << " " << draw.result.winners[4] << " " << draw.result.winners[5] << std::endl;
+    }
+
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    std::cout << "(" << sweep.DrawCount() << " draws, elapsed time: " << elapsed_ms.count() << " ms)" << std::endl;
+    return 0;
+}
+
+int runShard(const std::string& inputFile,
+             size_t shardIndex,
+             size_t shardCount,
+             const std::string& socketPath,
+             unsigned int threads,
+             const std::string& profilePath) {
+    if (shardCount == 0 || shardIndex >= shardCount) {
+        std::cout << "Invalid shard index " << shardIndex << " of " << shardCount << std::endl;
+        return 1;
+    }
+
+    // Only the shard's own plays are ever loaded
+    LotteryInputReader reader(inputFile);
+    reader.SetShard(shardIndex, shardCount);
+    if (!reader.Read(false)) {
+        std::cout << "Failed to read input file" << std::endl;
+        return 1;
+    }
+    const PlayersInfo& shard = reader.GetData();
+
+    LotteryProcessor::Config config;
+    if (!profilePath.empty()) {
+        Autotuner tuner;
+        config = tuner.LoadOrTune(profilePath, shard);
+    }
+    // The shards of one host share its cores: unless told otherwise each one gets its share
+    if (threads != 0) {
+        config.threads = threads;
+    } else if (profilePath.empty()) {
+        config.threads = std::max<unsigned int>(1, std::thread::hardware_concurrency() / shardCount);
+    }
+
+    ShardServer server(shard, socketPath, config);
+    if (!server.Listen()) {
+        return 1;
+    }
+
+    std::cout << "Shard " << shardIndex << "/" << shardCount << " serving " << shard.player_id.size()
+              << " plays and " << shard.system.player_id.size() << " system plays on " << socketPath
+              << " with " << Autotuner::Describe(config) << std::endl;
+    std::cout << "READY" << std::endl;
+    server.Serve();
+    return 0;
+}
+
+int runCoordinator(const std::vector<std::string>& socketPaths) {
+    ShardCoordinator coordinator(socketPaths);
+    std::vector<int> play;
+
+    if (!coordinator.Connect()) {
+        std::cout << "Failed to connect to shards" << std::endl;
+        return 1;
+    }
+
+    if (!readPlay(play)) {
+        return 1;
+    }
+
+    if (!Utils::ValidatePlay(play)) {
+        std::cout << "One or more of the picked numbers are not correct" << std::endl;
+        return 1;
+    }
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask(play, pickedNumMask);
+    LotteryProcessor::DrawResult result;
+    std::vector<uint64_t> winners;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    bool drawn = coordinator.Draw(pickedNumMask, 5, result, winners);
+    auto end = std::chrono::high_resolution_clock::now();
+    if (!drawn) {
+        return 1;
+    }
+
+    // Output results in the format: [2 matches count] [3 matches count] [4 matches count] [5 matches count]
+    std::cout << result.winners[2] << " " << result.winners[3] << " " << result.winners[4] << " " << result.winners[5] << std::endl;
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    std::cout << "(elapsed time: " << elapsed_ms.count() << " us)" << std::endl;
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--shard" && argc >= 6) {
+        size_t shardIndex, shardCount;
+        unsigned int threads = 0;
+        std::string profilePath;
+        bool validOptions = true;
+        try {
+            shardIndex = std::stoul(argv[3]);
+            shardCount = std::stoul(argv[4]);
+            for (int i = 6; i < argc; ++i) {
+                std::string option = argv[i];
+                if (option == "--threads" && i + 1 < argc) {
+                    threads = std::stoul(argv[++i]);
+                } else if (option == "--profile" && i + 1 < argc) {
+                    profilePath = argv[++i];
+                } else {
+                    validOptions = false;
+                }
+            }
+        } catch (const std::logic_error&) {
+            std::cout << "Invalid number in shard arguments" << std::endl;
+            return 1;
+        }
+
+        if (validOptions) {
+            return runShard(argv[2], shardIndex, shardCount, argv[5], threads, profilePath);
+        }
+    }
+
+    if (mode == "--coordinator" && argc > 2) {
+        return runCoordinator(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    if (mode == "--sweep" && argc == 9) {
+        std::vector<double> prizes;
+        long long topK = 0;
+        try {
+            for (int i = 5; i < 9; ++i) {
+                prizes.emplace_back(std::stod(argv[i]));
+            }
+            topK = std::stoll(argv[4]);
+        } catch (const std::logic_error&) {
+            std::cout << "Invalid number in sweep arguments" << std::endl;
+            return 1;
+        }
+
+        // More than every possible draw can't be reported (and would be reserved for the heaps)
+        if (topK >= 0 && topK <= Utils::Binomial(LiabilitySweep::Numbers, LiabilitySweep::DrawSize)) {
+            return runSweep(argv[2], argv[3], static_cast<size_t>(topK), prizes);
+        }
+    }
+
+    if (mode == "--autotune" && argc == 4) {
+        return runAutotune(argv[2], argv[3]);
+    }
+
+    if (mode == "--roofline" && argc == 3) {
+        return runRoofline(argv[2]);
+    }
+
+    if (argc >= 2 && mode.compare(0, 2, "--") != 0) {
+        RunOptions options;
+        bool validOptions = true;
+        for (int i = 2; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option == "--profile" && i + 1 < argc) {
+                options.profilePath = argv[++i];
+            } else if (option == "--resident") {
+                options.resident = true;
+            } else if (option == "--analytics") {
+                options.analytics = true;
+            } else if (option == "--audit" && i + 1 < argc) {
+                options.auditPath = argv[++i];
+            } else if (option == "--direct-io") {
+                options.directIo = true;
+            } else if (option == "--deadline" && i + 1 < argc) {
+                try {
+                    options.deadlineUs = std::stol(argv[++i]);
+                } catch (const std::logic_error&) {
+                    validOptions = false;
+                }
+                validOptions = validOptions && options.deadlineUs > 0;
+            } else {
+                validOptions = false;
+            }
+        }
+
+        // The audit record needs the exact histogram on the draw path
+        if (!options.auditPath.empty() && options.deadlineUs >= 0) {
+            validOptions = false;
+        }
+
+        if (validOptions) {
+            return runSingle(argv[1], options);
+        }
+    }
+
+    std::cout << "Usage: " << argv[0] << " <input_file> [--profile <profile_file>] [--resident] [--analytics] [--audit <log_file> [--direct-io]] [--deadline <us>]" << std::endl;
+    std::cout << "       " << argv[0] << " --autotune <input_file> <profile_file>" << std::endl;
+    std::cout << "       " << argv[0] << " --roofline <input_file>" << std::endl;
+    std::cout << "       " << argv[0] << " --sweep <input_file> <output_file> <top_k> <prize2> <prize3> <prize4> <prize5>" << std::endl;
+    std::cout << "       " << argv[0] << " --shard <input_file> <shard_index> <shard_count> <socket_path> [--threads <n>] [--profile <profile_file>]" << std::endl;
+    std::cout << "       " << argv[0] << " --coordinator <socket_path> [<socket_path>...]" << std::endl;
+    return 1;
+}
\ No newline at end of file
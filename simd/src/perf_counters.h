@@ -0,0 +1,158 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * Hardware performance counters for the calling thread and every thread it spawns while
+ * the counters are running (perf_event_open with inherit), so wrapping a Count call
+ * measures exactly the processing region, worker threads included.
+ *
+ * Each event is opened independently: events the PMU or perf_event_paranoid does not
+ * allow are simply reported as unavailable.
+ */
+class PerfCounters {
+public:
+    enum Event {
+        Cycles,
+        Instructions,
+        LlcMisses,
+        DtlbMisses,
+        EventCount
+    };
+
+    struct Sample {
+        uint64_t values[EventCount] = {0, 0, 0, 0};
+        bool available[EventCount] = {false, false, false, false};
+    };
+
+    PerfCounters() {
+        open(Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(LlcMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open(DtlbMisses, PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+
+    ~PerfCounters() {
+        for (int fd : m_fds) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool Available(Event event) const {
+        return m_fds[event] >= 0;
+    }
+
+    bool AnyAvailable() const {
+        for (int fd : m_fds) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    void Start() {
+        for (int fd : m_fds) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    Sample Stop() {
+        Sample sample;
+        for (int e = 0; e < EventCount; ++e) {
+            if (m_fds[e] >= 0) {
+                ::ioctl(m_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+
+        for (int e = 0; e < EventCount; ++e) {
+            if (m_fds[e] < 0) continue;
+
+            // value, time enabled, time running: scale when the PMU multiplexed the event
+            uint64_t data[3] = {0, 0, 0};
+            if (::read(m_fds[e], data, sizeof(data)) != sizeof(data)) continue;
+            sample.available[e] = true;
+            sample.values[e] = (data[2] != 0 && data[2] < data[1])
+                ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+                : data[0];
+        }
+        return sample;
+    }
+
+    // Why counters are missing, for the report
+    static std::string UnavailableReason() {
+        std::string reason = "hardware counters not available";
+        FILE* f = std::fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+        if (f != nullptr) {
+            int paranoid = 0;
+            if (std::fscanf(f, "%d", &paranoid) == 1) {
+                reason += " (perf_event_paranoid=" + std::to_string(paranoid) + ")";
+            }
+            std::fclose(f);
+        }
+        return reason;
+    }
+
+    /*
+     * Prints the per-play cost of one measured region:
+     * cycles/play, instructions/play, IPC, LLC miss bytes/play (a lower bound of the DRAM
+     * traffic, one 64-byte line per miss) and dTLB misses/play.
+     */
+    static void PrintPerPlay(const std::string& label, const Sample& sample, size_t plays) {
+        std::cout << "Per-play cost (" << label << "):";
+        bool any = false;
+        const double n = static_cast<double>(plays);
+        if (sample.available[Cycles]) {
+            std::cout << " cycles/play (" << sample.values[Cycles] / n << ")";
+            any = true;
+        }
+        if (sample.available[Instructions]) {
+            std::cout << " instructions/play (" << sample.values[Instructions] / n << ")";
+            any = true;
+        }
+        if (sample.available[Cycles] && sample.available[Instructions] && sample.values[Cycles] != 0) {
+            std::cout << " IPC (" << static_cast<double>(sample.values[Instructions]) / sample.values[Cycles] << ")";
+        }
+        if (sample.available[LlcMisses]) {
+            std::cout << " bytes/play (" << sample.values[LlcMisses] * 64 / n << ")";
+            any = true;
+        }
+        if (sample.available[DtlbMisses]) {
+            std::cout << " dTLB misses/play (" << sample.values[DtlbMisses] / n << ")";
+            any = true;
+        }
+        if (!any) {
+            std::cout << " " << UnavailableReason();
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    void open(Event event, uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        m_fds[event] = static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    int m_fds[EventCount] = {-1, -1, -1, -1};
+};
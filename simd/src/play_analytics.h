@@ -0,0 +1,269 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <immintrin.h>
+
+#include "utils.h"
+
+/*
+ * Pre-draw analytics over PlayersInfo::play_mask: per-number pick frequencies and the
+ * pair co-occurrence matrix of the ticket set.
+ *
+ * Like the draw histogram, a system ticket of n numbers counts as its C(n,5) covered plays:
+ * each of its numbers is in C(n-1,4) of them and each of its pairs in C(n-2,3).
+ *
+ * Update is incremental: it only folds in the plays appended since the previous call, so
+ * it can run while plays are being loaded and the tables are always ready to query.
+ * Cancelled plays are left out: each Update takes the plays tombstoned since the previous
+ * one back out of the tables. When the arrays were rebuilt in between (compaction, see
+ * BackgroundCompactor::Publish) the counted plays moved, so Update starts over with a full pass.
+ * Tables are indexed by number (1..60), matching the bit layout of play_mask.
+ */
+class PlayAnalytics {
+public:
+    static constexpr int Numbers = 60;
+
+    PlayAnalytics() : m_pairs(64 * 64, 0) {}
+
+    explicit PlayAnalytics(unsigned int threads) : m_threads(threads), m_pairs(64 * 64, 0) {}
+
+    void Update(const PlayersInfo& data) {
+        if (m_plain.Moved(data.player_id) || m_system.Moved(data.system.player_id)) {
+            Reset();
+        }
+
+        const size_t begin = m_plain.processed;
+        const size_t end = data.play_mask.size();
+        if (begin < end) {
+            countPlays(data, begin, end);
+            m_plain.Advance(data.player_id);
+        }
+
+        const SystemPlaysInfo& system = data.system;
+        for (size_t i = m_system.processed; i < system.play_mask.size(); ++i) {
+            addTicket(system.play_mask[i], system.pick_count[i], false);
+        }
+        m_system.Advance(system.player_id);
+
+        // Cancelled plays only ever show up as new tombstone bits
+        excludeCancelled(data.tombstone, m_plain.excluded, [&](size_t i) {
+            addTicket(data.play_mask[i], 5, true);
+        });
+        excludeCancelled(system.tombstone, m_system.excluded, [&](size_t i) {
+            addTicket(system.play_mask[i], system.pick_count[i], true);
+        });
+    }
+
+    void Reset() {
+        std::fill(m_frequencies, m_frequencies + 64, 0);
+        std::fill(m_pairs.begin(), m_pairs.end(), 0);
+        m_plain = Progress();
+        m_system = Progress();
+    }
+
+    // Plain plays counted so far (cancelled ones included)
+    size_t ProcessedPlays() const {
+        return m_plain.processed;
+    }
+
+    size_t ProcessedSystemPlays() const {
+        return m_system.processed;
+    }
+
+    // Number of plays containing number (1..60), counting each play covered by a system ticket
+    uint64_t Frequency(int number) const {
+        return m_frequencies[number];
+    }
+
+    // Number of plays containing both numbers (1..60); PairCount(n, n) == Frequency(n)
+    uint64_t PairCount(int a, int b) const {
+        if (a == b) {
+            return m_frequencies[a];
+        }
+        return a < b ? m_pairs[a * 64 + b] : m_pairs[b * 64 + a];
+    }
+
+    // Full 60x60 co-occurrence matrix, row-major, entry [(a-1)*60 + (b-1)] for numbers a and b
+    std::vector<uint64_t> PairMatrix() const {
+        std::vector<uint64_t> matrix(Numbers * Numbers);
+        for (int a = 1; a <= Numbers; ++a) {
+            for (int b = 1; b <= Numbers; ++b) {
+                matrix[(a - 1) * Numbers + (b - 1)] = PairCount(a, b);
+            }
+        }
+        return matrix;
+    }
+
+private:
+    // Below this, spawning threads costs more than counting
+    static constexpr size_t MinPlaysPerThread = 64 * 1024;
+
+    // Per-thread tables, indexed by bit position (== number)
+    struct Tables {
+        uint64_t frequencies[64] = {};
+        std::vector<uint64_t> pairs = std::vector<uint64_t>(64 * 64, 0);
+    };
+
+    void countPlays(const PlayersInfo& data, size_t begin, size_t end) {
+        /* Explanation: like LotteryProcessor::Process, the new plays are split in one chunk per thread.
+         * Each thread accumulates into its own frequency and pair tables, which are then reduced
+         * into the running totals, so no synchronization is needed on the hot path.
+         */
+        const unsigned int hardwareThreads = m_threads != 0
+            ? m_threads
+            : std::max(1u, std::thread::hardware_concurrency());
+        const unsigned int numThreads = (end - begin) < MinPlaysPerThread
+            ? 1
+            : std::min<size_t>(hardwareThreads, (end - begin) / MinPlaysPerThread);
+        std::vector<Tables> tables(numThreads);
+
+        if (numThreads == 1) {
+            countRange(data, begin, end, tables[0]);
+        } else {
+            std::vector<std::thread> threads;
+            size_t chunk = (end - begin) / numThreads;
+            for (unsigned int t = 0; t < numThreads; ++t) {
+                size_t start = begin + t * chunk;
+                size_t stop = (t+1==numThreads) ? end : start+chunk;
+                threads.emplace_back([&, start, stop, t]() {
+                    countRange(data, start, stop, tables[t]);
+                });
+            }
+
+            for (auto &th: threads) th.join();
+        }
+
+        for (const auto& table : tables) {
+            for (int bit = 0; bit < 64; ++bit) {
+                m_frequencies[bit] += table.frequencies[bit];
+            }
+            for (size_t i = 0; i < m_pairs.size(); ++i) {
+                m_pairs[i] += table.pairs[i];
+            }
+        }
+    }
+
+    // How far one of the play arrays has been counted
+    struct Progress {
+        size_t processed = 0;
+        uint64_t lastPlayerId = 0;      // player_id of play processed - 1
+        std::vector<uint64_t> excluded; // tombstone bits already taken out of the tables
+
+        // player_id is ascending and unique, so the last counted ID shows whether the counted prefix moved
+        bool Moved(const std::vector<uint64_t>& playerIds) const {
+            return processed != 0 && (processed > playerIds.size() || playerIds[processed - 1] != lastPlayerId);
+        }
+
+        void Advance(const std::vector<uint64_t>& playerIds) {
+            processed = playerIds.size();
+            lastPlayerId = processed != 0 ? playerIds[processed - 1] : 0;
+        }
+    };
+
+    /*
+     * Adds one ticket to the tables, or takes it back out. pickCount 5 (or less, for plain plays
+     * repeating a number) weighs every number and pair once; a system ticket weighs each number
+     * C(n-1,4) and each pair C(n-2,3) times.
+     */
+    void addTicket(uint64_t mask, size_t pickCount, bool remove) {
+        const int n = static_cast<int>(std::max<size_t>(pickCount, 5));
+        const uint64_t numberWeight = Utils::Binomial(n - 1, 4);
+        const uint64_t pairWeight = Utils::Binomial(n - 2, 3);
+        for (uint64_t a = mask; a != 0; a &= a - 1) {
+            const int bitA = __builtin_ctzll(a);
+            m_frequencies[bitA] = remove ? m_frequencies[bitA] - numberWeight : m_frequencies[bitA] + numberWeight;
+            for (uint64_t b = a & (a - 1); b != 0; b &= b - 1) {
+                uint64_t& pair = m_pairs[bitA * 64 + __builtin_ctzll(b)];
+                pair = remove ? pair - pairWeight : pair + pairWeight;
+            }
+        }
+    }
+
+    // Calls remove for every play tombstoned since the previous call and records its bit in excluded
+    template <typename Remove>
+    static void excludeCancelled(const std::vector<uint64_t>& tombstone, std::vector<uint64_t>& excluded, Remove remove) {
+        excluded.resize(std::max(excluded.size(), tombstone.size()), 0);
+        for (size_t word = 0; word < tombstone.size(); ++word) {
+            uint64_t bits = tombstone[word] & ~excluded[word];
+            while (bits != 0) {
+                remove(word * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+            }
+            excluded[word] = tombstone[word];
+        }
+    }
+
+    void countRange(const PlayersInfo& data, size_t start, size_t end, Tables& tables) const {
+        countFrequencies(data, start, end, tables);
+
+        // Pair counts: walk the set bits of each play, 10 increments for a 5-number play
+        for (size_t i = start; i < end; i++) {
+            uint64_t mask = data.play_mask[i];
+            int bits[64];
+            int count = 0;
+            while (mask != 0) {
+                bits[count++] = __builtin_ctzll(mask);
+                mask &= mask - 1;
+            }
+
+            for (int a = 0; a < count; ++a) {
+                uint64_t* row = &tables.pairs[bits[a] * 64];
+                for (int b = a + 1; b < count; ++b) {
+                    row[bits[b]]++;
+                }
+            }
+        }
+    }
+
+    /*
+     * Per-bit column counts with AVX2: the low and high 32-bit halves of each mask are
+     * broadcast and shifted by {0..31}, so every lane of 8 accumulators holds the count of
+     * one bit position. 32-bit lanes are flushed to the 64-bit totals before they can overflow.
+     */
+    void countFrequencies(const PlayersInfo& data, size_t start, size_t end, Tables& tables) const {
+        const __m256i one = _mm256_set1_epi32(1);
+        __m256i shifts[4];
+        for (int v = 0; v < 4; ++v) {
+            shifts[v] = _mm256_setr_epi32(v * 8, v * 8 + 1, v * 8 + 2, v * 8 + 3,
+                                          v * 8 + 4, v * 8 + 5, v * 8 + 6, v * 8 + 7);
+        }
+
+        size_t i = start;
+        while (i < end) {
+            const size_t blockEnd = std::min(end, i + FlushInterval);
+            __m256i counters[8];
+            for (auto& counter : counters) {
+                counter = _mm256_setzero_si256();
+            }
+
+            for (; i < blockEnd; i++) {
+                const uint64_t mask = data.play_mask[i];
+                const __m256i low = _mm256_set1_epi32(static_cast<int>(mask & 0xffffffff));
+                const __m256i high = _mm256_set1_epi32(static_cast<int>(mask >> 32));
+                for (int v = 0; v < 4; ++v) {
+                    counters[v] = _mm256_add_epi32(counters[v], _mm256_and_si256(_mm256_srlv_epi32(low, shifts[v]), one));
+                    counters[v + 4] = _mm256_add_epi32(counters[v + 4], _mm256_and_si256(_mm256_srlv_epi32(high, shifts[v]), one));
+                }
+            }
+
+            alignas(32) uint32_t lanes[64];
+            for (int v = 0; v < 8; ++v) {
+                _mm256_store_si256(reinterpret_cast<__m256i*>(&lanes[v * 8]), counters[v]);
+            }
+            for (int bit = 0; bit < 64; ++bit) {
+                tables.frequencies[bit] += lanes[bit];
+            }
+        }
+    }
+
+    static constexpr size_t FlushInterval = 1u << 30;
+
+    unsigned int m_threads = 0;
+    uint64_t m_frequencies[64] = {};
+    std::vector<uint64_t> m_pairs; // upper triangle, [a * 64 + b] with a < b
+    Progress m_plain;
+    Progress m_system;
+};
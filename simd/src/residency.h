@@ -0,0 +1,187 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "lottery_processor.h"
+#include "utils.h"
+
+/*
+ * Makes the PlayersInfo arrays resident before the first draw: the first Process call
+ * after Read() otherwise pays for page faults, a cold TLB and a cold LLC, and pages of
+ * play_mask may have been reclaimed under memory pressure.
+ *
+ * MakeResident prefaults every page, pins the arrays with mlock and optionally runs a
+ * warm-up sweep with the processor that will serve the draws. Unlocked pages can be
+ * reclaimed again right away, so prefaulting is repeated (up to attempts times) until
+ * mincore reports every page resident. Failing to lock (e.g. RLIMIT_MEMLOCK too low) is
+ * reported but not fatal; callers decide what a report that is not FullyResident means.
+ */
+class Residency {
+public:
+    struct Options {
+        bool lock = true;
+        size_t warmupSweeps = 2; // 0 disables the warm-up sweep
+        size_t attempts = 3;     // prefault passes until every page is resident
+    };
+
+    struct Report {
+        size_t bytes = 0;
+        size_t residentBytes = 0;
+        bool locked = false;
+        size_t attempts = 0;
+        uint64_t prefaultUs = 0;
+        uint64_t lockUs = 0;
+        uint64_t warmupUs = 0;
+
+        bool FullyResident() const {
+            return residentBytes == bytes;
+        }
+    };
+
+    static Report MakeResident(const PlayersInfo& data, LotteryProcessor& processor, const Options& options) {
+        Report report;
+        const std::vector<Region> regions = dataRegions(data);
+
+        uint64_t prefaultNs = 0;
+        uint64_t lockNs = 0;
+        while (report.attempts < std::max<size_t>(1, options.attempts)) {
+            report.attempts++;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const auto& region : regions) {
+                prefault(region);
+            }
+            auto prefaulted = std::chrono::high_resolution_clock::now();
+
+            report.locked = options.lock;
+            for (const auto& region : regions) {
+                if (options.lock && ::mlock(region.begin, region.size) != 0) {
+                    std::cout << "Error locking dataset in memory: " << std::strerror(errno) << std::endl;
+                    report.locked = false;
+                }
+            }
+            auto locked = std::chrono::high_resolution_clock::now();
+            prefaultNs += std::chrono::duration_cast<std::chrono::nanoseconds>(prefaulted - start).count();
+            lockNs += std::chrono::duration_cast<std::chrono::nanoseconds>(locked - prefaulted).count();
+
+            if (residentBytes(regions) == totalBytes(regions)) {
+                break;
+            }
+        }
+
+        auto warmupStart = std::chrono::high_resolution_clock::now();
+
+        uint64_t pickedNumMask = 0;
+        Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+        for (size_t i = 0; i < options.warmupSweeps; ++i) {
+            processor.Count(data, pickedNumMask);
+        }
+        auto warmed = std::chrono::high_resolution_clock::now();
+
+        report.bytes = totalBytes(regions);
+        report.residentBytes = residentBytes(regions);
+        report.prefaultUs = prefaultNs / 1000;
+        report.lockUs = lockNs / 1000;
+        report.warmupUs = std::chrono::duration_cast<std::chrono::microseconds>(warmed - warmupStart).count();
+        return report;
+    }
+
+    // Unpins the arrays; must be called before the dataset is modified or destroyed
+    static void Release(const PlayersInfo& data) {
+        for (const auto& region : dataRegions(data)) {
+            ::munlock(region.begin, region.size);
+        }
+    }
+
+    static void Print(const Report& report) {
+        std::cout << "Resident: " << report.residentBytes << "/" << report.bytes << " bytes"
+                  << (report.locked ? " locked" : " not locked")
+                  << " (prefault " << report.prefaultUs << " us, mlock " << report.lockUs
+                  << " us, warm-up " << report.warmupUs << " us";
+        if (report.attempts > 1) {
+            std::cout << ", " << report.attempts << " prefault passes";
+        }
+        std::cout << ")" << std::endl;
+    }
+
+private:
+    // Page-aligned span covering one array
+    struct Region {
+        char* begin = nullptr;
+        size_t size = 0;
+    };
+
+    static std::vector<Region> dataRegions(const PlayersInfo& data) {
+        std::vector<Region> regions;
+        for (const auto* array : {&data.player_id, &data.play_mask, &data.tombstone,
+                                  &data.system.player_id, &data.system.play_mask, &data.system.tombstone}) {
+            if (array->empty()) {
+                continue;
+            }
+            regions.emplace_back(pageAligned(array->data(), array->size() * sizeof(uint64_t)));
+        }
+        if (!data.system.pick_count.empty()) {
+            regions.emplace_back(pageAligned(data.system.pick_count.data(), data.system.pick_count.size()));
+        }
+        return regions;
+    }
+
+    static Region pageAligned(const void* ptr, size_t size) {
+        const uintptr_t pageSize = ::sysconf(_SC_PAGESIZE);
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(pageSize - 1);
+        const uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + size + pageSize - 1) & ~(pageSize - 1);
+
+        Region region;
+        region.begin = reinterpret_cast<char*>(begin);
+        region.size = end - begin;
+        return region;
+    }
+
+    static void prefault(const Region& region) {
+        const size_t pageSize = ::sysconf(_SC_PAGESIZE);
+        ::madvise(region.begin, region.size, MADV_WILLNEED);
+
+        // One read per page is enough to fault it in (or back in, if it was swapped out)
+        volatile char sink = 0;
+        for (size_t offset = 0; offset < region.size; offset += pageSize) {
+            sink = sink + region.begin[offset];
+        }
+        (void)sink;
+    }
+
+    static size_t totalBytes(const std::vector<Region>& regions) {
+        size_t bytes = 0;
+        for (const auto& region : regions) {
+            bytes += region.size;
+        }
+        return bytes;
+    }
+
+    static size_t residentBytes(const std::vector<Region>& regions) {
+        size_t bytes = 0;
+        for (const auto& region : regions) {
+            bytes += residentBytes(region);
+        }
+        return bytes;
+    }
+
+    static size_t residentBytes(const Region& region) {
+        const size_t pageSize = ::sysconf(_SC_PAGESIZE);
+        std::vector<unsigned char> pages((region.size + pageSize - 1) / pageSize);
+        if (::mincore(region.begin, region.size, pages.data()) != 0) {
+            return 0;
+        }
+
+        size_t resident = 0;
+        for (unsigned char page : pages) {
+            resident += (page & 1) ? pageSize : 0;
+        }
+        return resident;
+    }
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <set>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#include <unistd.h>
+
+#include "lottery_processor.h"
+#include "utils.h"
+
+/*
+ * Memory-bandwidth roofline for the matching kernels. A Count over N plays reads at least
+ * N * 8 bytes of play_mask and does a handful of instructions per play, so once the dataset
+ * is larger than the last-level cache its ceiling is the read bandwidth of the host.
+ *
+ * MeasureReadBandwidth is a STREAM-style read-only sweep (AVX2 loads summed into four
+ * accumulators) over a buffer much larger than the LLC, split statically across threads.
+ * MeasureKernel times Count with a given Config and converts it to play_mask bytes per
+ * second. Both keep the best of several runs, like STREAM does.
+ */
+class Roofline {
+public:
+    struct Options {
+        size_t bufferBytes = 512ull << 20; // STREAM buffer, should be several times the LLC
+        size_t runs = 10;
+        std::vector<size_t> prefetchDistances = {64, 128, 256, 512, 1024, 2048, 4096};
+    };
+
+    struct KernelPoint {
+        LotteryProcessor::Config config;
+        double gbPerSec = 0;
+        double rooflineGbPerSec = 0;
+
+        double Fraction() const {
+            return rooflineGbPerSec > 0 ? gbPerSec / rooflineGbPerSec : 0;
+        }
+    };
+
+    Roofline() : Roofline(Options()) {}
+
+    explicit Roofline(const Options& options) : m_options(options) {}
+
+    ~Roofline() {
+        std::free(m_buffer);
+    }
+
+    Roofline(const Roofline&) = delete;
+    Roofline& operator=(const Roofline&) = delete;
+
+    // Read bandwidth in GB/s (1e9 bytes) with the given number of threads, 0 if the buffer can't be allocated
+    double MeasureReadBandwidth(unsigned int threads) {
+        if (!allocateBuffer()) {
+            return 0;
+        }
+        const size_t words = m_bufferBytes / sizeof(uint64_t);
+        std::vector<uint64_t> sinks(threads * 8); // one cache line per thread
+
+        double best = 0;
+        for (size_t run = 0; run < m_options.runs; ++run) {
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> workers;
+            const size_t chunk = words / threads / 4 * 4;
+            for (unsigned int t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t]() {
+                    sinks[t * 8] = sumRange(m_buffer + t * chunk, chunk);
+                });
+            }
+            for (auto &th: workers) th.join();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            const double seconds = std::chrono::duration<double>(end - start).count();
+            best = std::max(best, (chunk * threads * sizeof(uint64_t)) / seconds / 1e9);
+        }
+        return best;
+    }
+
+    // Bytes of play_mask scanned per second by Count with config, in GB/s
+    double MeasureKernel(const PlayersInfo& data, const LotteryProcessor::Config& config) {
+        uint64_t pickedNumMask = 0;
+        Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+        LotteryProcessor lp(config);
+        lp.Count(data, pickedNumMask); // warm-up
+
+        double best = 0;
+        for (size_t run = 0; run < m_options.runs; ++run) {
+            auto start = std::chrono::high_resolution_clock::now();
+            lp.Count(data, pickedNumMask);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            const double seconds = std::chrono::duration<double>(end - start).count();
+            best = std::max(best, (data.play_mask.size() * sizeof(uint64_t)) / seconds / 1e9);
+        }
+        return best;
+    }
+
+    /*
+     * Measures the roofline at every thread count, then every kernel (the prefetching ones at
+     * their best prefetch distance) against it. Prints one line per measurement. Returns no
+     * points when the bandwidth buffer can't be allocated.
+     */
+    std::vector<KernelPoint> Run(const PlayersInfo& data) {
+        const size_t datasetBytes = data.play_mask.size() * sizeof(uint64_t);
+        const long llcBytes = ::sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (llcBytes > 0 && datasetBytes < static_cast<size_t>(llcBytes) * 2) {
+            std::cout << "Warning: play_mask (" << (datasetBytes >> 20) << " MiB) does not exceed the LLC ("
+                      << (llcBytes >> 20) << " MiB), kernels may beat the DRAM roofline" << std::endl;
+        }
+
+        std::vector<KernelPoint> points;
+        for (unsigned int threads : threadCounts()) {
+            const double roofline = MeasureReadBandwidth(threads);
+            if (roofline == 0) {
+                return {};
+            }
+            std::cout << "Read bandwidth with " << threads << " threads: " << std::fixed << std::setprecision(2)
+                      << roofline << " GB/s" << std::endl;
+
+            for (auto kernel : LotteryProcessor::Kernels) {
+                KernelPoint point;
+                point.config.threads = threads;
+                point.config.kernel = kernel;
+                point.rooflineGbPerSec = roofline;
+
+                const bool prefetches = kernel == LotteryProcessor::Kernel::Avx2Prefetch ||
+                                        kernel == LotteryProcessor::Kernel::Avx2Stream;
+                const std::vector<size_t> distances = prefetches
+                    ? m_options.prefetchDistances
+                    : std::vector<size_t>{point.config.prefetchDistance};
+                for (size_t distance : distances) {
+                    LotteryProcessor::Config config = point.config;
+                    config.prefetchDistance = distance;
+                    const double gbPerSec = MeasureKernel(data, config);
+                    if (gbPerSec > point.gbPerSec) {
+                        point.gbPerSec = gbPerSec;
+                        point.config.prefetchDistance = distance;
+                    }
+                }
+
+                std::cout << "  " << LotteryProcessor::KernelName(kernel);
+                if (prefetches) {
+                    std::cout << " (prefetch " << point.config.prefetchDistance << ")";
+                }
+                std::cout << ": " << std::fixed << std::setprecision(2) << point.gbPerSec << " GB/s, "
+                          << std::setprecision(1) << point.Fraction() * 100 << "% of roofline" << std::endl;
+                points.emplace_back(point);
+            }
+        }
+        return points;
+    }
+
+private:
+    // Powers of two up to the hardware thread count, plus the count itself
+    static std::set<unsigned int> threadCounts() {
+        const unsigned int logical = std::max(1u, std::thread::hardware_concurrency());
+        std::set<unsigned int> counts = {logical};
+        for (unsigned int t = 1; t < logical; t <<= 1) {
+            counts.insert(t);
+        }
+        return counts;
+    }
+
+    bool allocateBuffer() {
+        if (m_buffer != nullptr) {
+            return true;
+        }
+
+        const size_t bufferBytes = std::max<size_t>(4096, m_options.bufferBytes / 4096 * 4096);
+        m_buffer = static_cast<uint64_t*>(std::aligned_alloc(4096, bufferBytes));
+        if (m_buffer == nullptr) {
+            std::cout << "Error allocating the " << (bufferBytes >> 20) << " MiB bandwidth buffer" << std::endl;
+            return false;
+        }
+        m_bufferBytes = bufferBytes;
+
+        // Touch every page so the first run does not measure page faults
+        std::memset(m_buffer, 1, m_bufferBytes);
+        return true;
+    }
+
+    // Four independent accumulators keep the loop bound by loads rather than by the add chain
+    static uint64_t sumRange(const uint64_t* words, size_t count) {
+        __m256i sum0 = _mm256_setzero_si256();
+        __m256i sum1 = _mm256_setzero_si256();
+        __m256i sum2 = _mm256_setzero_si256();
+        __m256i sum3 = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            sum0 = _mm256_add_epi64(sum0, _mm256_load_si256((const __m256i*)&words[i]));
+            sum1 = _mm256_add_epi64(sum1, _mm256_load_si256((const __m256i*)&words[i + 4]));
+            sum2 = _mm256_add_epi64(sum2, _mm256_load_si256((const __m256i*)&words[i + 8]));
+            sum3 = _mm256_add_epi64(sum3, _mm256_load_si256((const __m256i*)&words[i + 12]));
+        }
+
+        __m256i sum = _mm256_add_epi64(_mm256_add_epi64(sum0, sum1), _mm256_add_epi64(sum2, sum3));
+        uint64_t total = (uint64_t)_mm256_extract_epi64(sum, 0) + (uint64_t)_mm256_extract_epi64(sum, 1) +
+                         (uint64_t)_mm256_extract_epi64(sum, 2) + (uint64_t)_mm256_extract_epi64(sum, 3);
+        for (; i < count; i++) {
+            total += words[i];
+        }
+        return total;
+    }
+
+    Options m_options;
+    uint64_t* m_buffer = nullptr;
+    size_t m_bufferBytes = 0;
+};
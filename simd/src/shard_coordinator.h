@@ -0,0 +1,137 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "lottery_processor.h"
+#include "shard_server.h"
+#include "utils.h"
+
+/*
+ * Fans a draw out to every shard process and merges the partial results.
+ *
+ * Shards split the dataset by player_id range, so the merged histogram is the sum of
+ * the shard histograms and the merged winner list is the concatenation of the shard
+ * winner lists in shard order (already sorted by player_id).
+ *
+ * A failed draw closes every shard connection: the shards that did answer would otherwise
+ * leave their responses unread, to be taken for the next draw's. Connect again before the
+ * next Draw.
+ */
+class ShardCoordinator {
+public:
+    explicit ShardCoordinator(const std::vector<std::string>& socketPaths)
+        : m_socketPaths(socketPaths) {}
+
+    ~ShardCoordinator() {
+        disconnect();
+    }
+
+    // Connects to every shard, replacing any previous connections
+    bool Connect() {
+        disconnect();
+        for (const auto& socketPath : m_socketPaths) {
+            sockaddr_un address;
+            if (!ShardProtocol::FillAddress(socketPath, address)) {
+                disconnect();
+                return false;
+            }
+
+            int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+                std::cout << "Error connecting to shard " << socketPath << ": " << std::strerror(errno) << std::endl;
+                if (fd >= 0) ::close(fd);
+                disconnect();
+                return false;
+            }
+
+            m_shardFds.emplace_back(fd);
+        }
+
+        return !m_shardFds.empty();
+    }
+
+    bool Draw(const uint64_t pickedNumMask,
+              const int minWinnerMatches,
+              LotteryProcessor::DrawResult& result,
+              std::vector<uint64_t>& winners) {
+        if (!Utils::ValidateDrawMask(pickedNumMask)) {
+            std::cout << "Invalid draw mask" << std::endl;
+            return false;
+        }
+        if (minWinnerMatches < 1 || minWinnerMatches > 5) {
+            std::cout << "Invalid minimum winner matches " << minWinnerMatches << std::endl;
+            return false;
+        }
+        if (m_shardFds.empty()) {
+            std::cout << "Not connected to the shards" << std::endl;
+            return false;
+        }
+
+        ShardProtocol::ShardRequest request;
+        request.command = ShardProtocol::Draw;
+        request.minWinnerMatches = minWinnerMatches;
+        request.pickedNumMask = pickedNumMask;
+
+        // Scatter first so every shard works on the draw concurrently...
+        for (int fd : m_shardFds) {
+            if (!ShardProtocol::WriteAll(fd, &request, sizeof(request))) {
+                std::cout << "Error sending draw to shard" << std::endl;
+                disconnect();
+                return false;
+            }
+        }
+
+        // ...then gather in shard order
+        result = LotteryProcessor::DrawResult();
+        winners.clear();
+        for (int fd : m_shardFds) {
+            ShardProtocol::ShardResponse response;
+            if (!ShardProtocol::ReadAll(fd, &response, sizeof(response))) {
+                std::cout << "Error receiving draw result from shard" << std::endl;
+                disconnect();
+                return false;
+            }
+
+            for (int i = 0; i < 6; ++i) {
+                result.winners[i] += response.winners[i];
+            }
+
+            size_t offset = winners.size();
+            winners.resize(offset + response.winnerCount);
+            if (!ShardProtocol::ReadAll(fd, winners.data() + offset, response.winnerCount * sizeof(uint64_t))) {
+                std::cout << "Error receiving winners from shard" << std::endl;
+                disconnect();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Asks every shard process to stop serving
+    void Shutdown() {
+        ShardProtocol::ShardRequest request;
+        request.command = ShardProtocol::Shutdown;
+        for (int fd : m_shardFds) {
+            ShardProtocol::WriteAll(fd, &request, sizeof(request));
+        }
+    }
+
+private:
+    void disconnect() {
+        for (int fd : m_shardFds) {
+            ::close(fd);
+        }
+        m_shardFds.clear();
+    }
+
+    std::vector<std::string> m_socketPaths;
+    std::vector<int> m_shardFds;
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <tuple>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "lottery_processor.h"
+#include "draw_result_cache.h"
+#include "utils.h"
+
+/*
+ * Wire protocol between the coordinator and the shard processes (Unix stream sockets,
+ * native endianness since both ends always run on the same host).
+ *
+ * Each request is a fixed-size ShardRequest. A draw is answered with a ShardResponse
+ * followed by winnerCount player IDs (uint64_t). A shard closes the connection instead of
+ * answering an invalid draw mask, a minWinnerMatches outside 1..5 or a winner list too long
+ * for winnerCount.
+ */
+namespace ShardProtocol {
+    enum Command : uint32_t {
+        Draw = 1,
+        Shutdown = 2,
+    };
+
+    struct ShardRequest {
+        uint32_t command = Draw;
+        uint32_t minWinnerMatches = 5;
+        uint64_t pickedNumMask = 0;
+    };
+
+    struct ShardResponse {
+        int64_t winners[6] = {0, 0, 0, 0, 0, 0};
+        uint32_t winnerCount = 0;
+        uint64_t epoch = 0;
+    };
+
+    inline bool WriteAll(int fd, const void* buffer, size_t size) {
+        const char* ptr = static_cast<const char*>(buffer);
+        while (size > 0) {
+            ssize_t written = ::send(fd, ptr, size, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            ptr += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    inline bool ReadAll(int fd, void* buffer, size_t size) {
+        char* ptr = static_cast<char*>(buffer);
+        while (size > 0) {
+            ssize_t received = ::recv(fd, ptr, size, 0);
+            if (received < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (received == 0) {
+                return false; // peer closed the connection
+            }
+            ptr += received;
+            size -= received;
+        }
+        return true;
+    }
+
+    inline bool FillAddress(const std::string& socketPath, sockaddr_un& address) {
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            std::cout << "Socket path too long: " << socketPath << std::endl;
+            return false;
+        }
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        return true;
+    }
+}
+
+/*
+ * Serves draws for one shard of the dataset over a Unix socket. Connections are handled
+ * one at a time and may carry any number of requests; a Shutdown request stops the server.
+ * Histograms go through a draw result cache, so coordinator retries and repeated draws
+ * only pay for the winner list. Shards running side by side share the cores, so config
+ * should give each one its share (see config.threads) rather than every hardware thread.
+ */
+class ShardServer {
+public:
+    ShardServer(const PlayersInfo& data, const std::string& socketPath)
+        : ShardServer(data, socketPath, LotteryProcessor::Config()) {}
+
+    ShardServer(const PlayersInfo& data, const std::string& socketPath, const LotteryProcessor::Config& config)
+        : m_data(data), m_socketPath(socketPath), m_processor(config) {}
+
+    ~ShardServer() {
+        if (m_listenFd >= 0) {
+            ::close(m_listenFd);
+            ::unlink(m_socketPath.c_str());
+        }
+    }
+
+    bool Listen() {
+        sockaddr_un address;
+        if (!ShardProtocol::FillAddress(m_socketPath, address)) {
+            return false;
+        }
+
+        m_listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listenFd < 0) {
+            std::cout << "Error creating socket: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        ::unlink(m_socketPath.c_str());
+        if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            ::listen(m_listenFd, 16) < 0) {
+            std::cout << "Error listening on " << m_socketPath << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // Blocks until a Shutdown request is received
+    void Serve() {
+        bool running = true;
+        while (running) {
+            int fd = ::accept(m_listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                std::cout << "Error accepting connection: " << std::strerror(errno) << std::endl;
+                return;
+            }
+
+            running = serveConnection(fd);
+            ::close(fd);
+        }
+    }
+
+    DrawResultCache::Stats GetCacheStats() const {
+        return m_processor.GetStats();
+    }
+
+private:
+    bool serveConnection(int fd) {
+        ShardProtocol::ShardRequest request;
+        while (ShardProtocol::ReadAll(fd, &request, sizeof(request))) {
+            if (request.command == ShardProtocol::Shutdown) {
+                return false;
+            }
+
+            // Never count an unchecked request: dropping the connection fails the coordinator's draw
+            if (!Utils::ValidateDrawMask(request.pickedNumMask)) {
+                std::cout << "Rejected invalid draw mask " << request.pickedNumMask << std::endl;
+                break;
+            }
+            if (request.minWinnerMatches < 1 || request.minWinnerMatches > 5) {
+                std::cout << "Rejected invalid minimum winner matches " << request.minWinnerMatches << std::endl;
+                break;
+            }
+
+            m_winners.clear();
+            LotteryProcessor::DrawResult result = m_processor.Count(m_data, request.pickedNumMask);
+            m_processor.CollectWinners(m_data, request.pickedNumMask, request.minWinnerMatches, m_winners);
+            if (m_winners.size() > UINT32_MAX) {
+                std::cout << "Refused a winner list of " << m_winners.size() << " player IDs" << std::endl;
+                break;
+            }
+
+            ShardProtocol::ShardResponse response;
+            std::copy(result.winners, result.winners + 6, response.winners);
+            response.winnerCount = static_cast<uint32_t>(m_winners.size());
+            response.epoch = m_data.epoch;
+
+            if (!ShardProtocol::WriteAll(fd, &response, sizeof(response)) ||
+                !ShardProtocol::WriteAll(fd, m_winners.data(), m_winners.size() * sizeof(uint64_t))) {
+                break;
+            }
+        }
+
+        // Coordinator went away, keep accepting new ones
+        return true;
+    }
+
+    const PlayersInfo& m_data;
+    std::string m_socketPath;
+    int m_listenFd = -1;
+    CachedLotteryProcessor m_processor;
+    std::vector<uint64_t> m_winners;
+};
+
+/*
+ * Returns the live (not cancelled) plays whose player_id falls in the shardIndex-th of
+ * shardCount equal player_id ranges of data.
+ */
+inline PlayersInfo SplitByPlayerIdRange(const PlayersInfo& data, size_t shardIndex, size_t shardCount) {
+    PlayersInfo shard;
+    shard.epoch = Utils::NextEpoch();
+    if ((data.player_id.empty() && data.system.player_id.empty()) || shardCount == 0) {
+        return shard;
+    }
+
+    uint64_t firstId = UINT64_MAX;
+    uint64_t lastId = 0;
+    for (const auto* ids : {&data.player_id, &data.system.player_id}) {
+        if (!ids->empty()) {
+            auto minmax = std::minmax_element(ids->begin(), ids->end());
+            firstId = std::min(firstId, *minmax.first);
+            lastId = std::max(lastId, *minmax.second);
+        }
+    }
+    uint64_t rangeStart, rangeEnd;
+    std::tie(rangeStart, rangeEnd) = Utils::ShardIdRange(firstId, lastId, shardIndex, shardCount);
+
+    for (size_t i = 0; i < data.player_id.size(); i++) {
+        if (data.player_id[i] >= rangeStart && data.player_id[i] < rangeEnd && !Utils::IsCancelled(data, i)) {
+            shard.player_id.emplace_back(data.player_id[i]);
+            shard.play_mask.emplace_back(data.play_mask[i]);
+        }
+    }
+
+    const SystemPlaysInfo& system = data.system;
+    for (size_t i = 0; i < system.player_id.size(); i++) {
+        if (system.player_id[i] >= rangeStart && system.player_id[i] < rangeEnd && !Utils::IsCancelled(system.tombstone, i)) {
+            shard.system.player_id.emplace_back(system.player_id[i]);
+            shard.system.play_mask.emplace_back(system.play_mask[i]);
+            shard.system.pick_count.emplace_back(system.pick_count[i]);
+        }
+    }
+
+    return shard;
+}
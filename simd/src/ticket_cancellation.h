@@ -0,0 +1,214 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "utils.h"
+
+/*
+ * Ticket cancellation by player_id, backed by the PlayersInfo tombstone bitmap: cancelled
+ * plays stay in the arrays and are excluded by the processor until the next compaction.
+ *
+ * Player IDs are looked up with a binary search, so player_id must be ascending (which
+ * LotteryInputReader guarantees). Like any other mutation, cancelling must not run
+ * concurrently with Process on the same dataset.
+ */
+class TicketCancellation {
+public:
+    // Returns how many plays were newly cancelled; unknown and already cancelled IDs are ignored
+    static size_t Cancel(PlayersInfo& data, const std::vector<uint64_t>& playerIds) {
+        data.tombstone.resize((data.play_mask.size() + 63) / 64, 0);
+        data.system.tombstone.resize((data.system.play_mask.size() + 63) / 64, 0);
+
+        size_t newlyCancelled = 0;
+        for (uint64_t playerId : playerIds) {
+            // Plain plays first, then system tickets (player IDs are unique across both)
+            if (tombstoneById(data.player_id, data.tombstone, playerId, data.cancelled) ||
+                tombstoneById(data.system.player_id, data.system.tombstone, playerId, data.system.cancelled)) {
+                newlyCancelled++;
+            }
+        }
+
+        if (newlyCancelled != 0) {
+            data.epoch = Utils::NextEpoch();
+        }
+        return newlyCancelled;
+    }
+
+    // Returns a copy of data without its cancelled plays
+    static PlayersInfo Compact(const PlayersInfo& data) {
+        PlayersInfo compacted = CompactArrays(data.player_id, data.play_mask, data.tombstone);
+        compacted.system = CompactSystem(data.system);
+        compacted.epoch = Utils::NextEpoch();
+        return compacted;
+    }
+
+    // Copies the plays not marked in tombstone; the epoch is left for the caller to set
+    static PlayersInfo CompactArrays(const std::vector<uint64_t>& playerIds,
+                                     const std::vector<uint64_t>& playMasks,
+                                     const std::vector<uint64_t>& tombstone) {
+        PlayersInfo compacted;
+        compacted.player_id.reserve(playerIds.size());
+        compacted.play_mask.reserve(playMasks.size());
+
+        for (size_t i = 0; i < playMasks.size(); i++) {
+            const size_t word = i / 64;
+            if (word < tombstone.size() && ((tombstone[word] >> (i % 64)) & 1) != 0) {
+                continue;
+            }
+            compacted.player_id.emplace_back(playerIds[i]);
+            compacted.play_mask.emplace_back(playMasks[i]);
+        }
+
+        return compacted;
+    }
+
+    // Copies the system tickets not marked in their tombstone
+    static SystemPlaysInfo CompactSystem(const SystemPlaysInfo& system) {
+        SystemPlaysInfo compacted;
+        for (size_t i = 0; i < system.play_mask.size(); i++) {
+            if (Utils::IsCancelled(system.tombstone, i)) {
+                continue;
+            }
+            compacted.player_id.emplace_back(system.player_id[i]);
+            compacted.play_mask.emplace_back(system.play_mask[i]);
+            compacted.pick_count.emplace_back(system.pick_count[i]);
+        }
+        return compacted;
+    }
+
+private:
+    static bool tombstoneById(const std::vector<uint64_t>& playerIds,
+                              std::vector<uint64_t>& tombstone,
+                              uint64_t playerId,
+                              size_t& cancelled) {
+        auto it = std::lower_bound(playerIds.begin(), playerIds.end(), playerId);
+        if (it == playerIds.end() || *it != playerId) {
+            return false;
+        }
+
+        const size_t index = it - playerIds.begin();
+        const uint64_t bit = 1ULL << (index % 64);
+        if ((tombstone[index / 64] & bit) != 0) {
+            return false;
+        }
+        tombstone[index / 64] |= bit;
+        cancelled++;
+        return true;
+    }
+};
+
+/*
+ * Rebuilds the arrays without cancelled plays on a background thread, so cancellations
+ * stop costing scan bandwidth and memory.
+ *
+ * The worker reads player_id and play_mask of the live dataset (which Cancel never
+ * modifies) and a snapshot of the tombstone bitmap taken by Start; plays must not be
+ * appended until Publish. Publish swaps the compacted arrays in and re-applies the
+ * cancellations that happened after Start. System tickets are few, so they are compacted
+ * inline by Publish.
+ *
+ * Poll is the periodic trigger: the thread that owns the dataset calls it between draws
+ * and it never blocks on the worker. Nothing in this tree cancels while serving, so the
+ * caller that does decides when to poll.
+ *
+ * Publish replaces the arrays, so whatever was tied to the old ones has to follow: a
+ * PlayAnalytics recounts on its next Update, and a dataset made resident must be passed
+ * to Residency::MakeResident again (the old pages are freed and the new ones are not locked).
+ */
+class BackgroundCompactor {
+public:
+    ~BackgroundCompactor() {
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    static bool ShouldCompact(const PlayersInfo& data, double cancelledFraction) {
+        return data.cancelled != 0 && data.cancelled >= cancelledFraction * data.play_mask.size();
+    }
+
+    // Starts compacting when more than cancelledFraction of the plays are cancelled
+    bool MaybeStart(const PlayersInfo& live, double cancelledFraction) {
+        if (Pending() || !ShouldCompact(live, cancelledFraction)) {
+            return false;
+        }
+
+        Start(live);
+        return true;
+    }
+
+    void Start(const PlayersInfo& live) {
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+
+        m_snapshot = live.tombstone;
+        m_done.store(false, std::memory_order_relaxed);
+        m_worker = std::thread([this, &live]() {
+            m_compacted = TicketCancellation::CompactArrays(live.player_id, live.play_mask, m_snapshot);
+            m_done.store(true, std::memory_order_release);
+        });
+    }
+
+    // Publishes a finished compaction, or checks at most once per interval whether to start
+    // one. Returns true when live was replaced.
+    bool Poll(PlayersInfo& live, double cancelledFraction, std::chrono::milliseconds interval) {
+        if (Pending()) {
+            return m_done.load(std::memory_order_acquire) && Publish(live);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - m_lastCheck < interval) {
+            return false;
+        }
+        m_lastCheck = now;
+        MaybeStart(live, cancelledFraction);
+        return false;
+    }
+
+    // True from Start until Publish
+    bool Pending() const {
+        return m_worker.joinable();
+    }
+
+    // Waits for the compaction and swaps it into live
+    bool Publish(PlayersInfo& live) {
+        if (!m_worker.joinable()) {
+            return false;
+        }
+        m_worker.join();
+
+        // Cancellations made while compacting: bits set in live but not in the snapshot
+        std::vector<uint64_t> lateIds;
+        for (size_t word = 0; word < live.tombstone.size(); ++word) {
+            uint64_t bits = live.tombstone[word] & ~(word < m_snapshot.size() ? m_snapshot[word] : 0);
+            while (bits != 0) {
+                lateIds.emplace_back(live.player_id[word * 64 + __builtin_ctzll(bits)]);
+                bits &= bits - 1;
+            }
+        }
+
+        m_compacted.system = TicketCancellation::CompactSystem(live.system);
+        m_compacted.epoch = Utils::NextEpoch();
+        if (!lateIds.empty()) {
+            TicketCancellation::Cancel(m_compacted, lateIds);
+        }
+
+        live = std::move(m_compacted);
+        m_compacted = PlayersInfo();
+        m_snapshot.clear();
+        return true;
+    }
+
+private:
+    std::thread m_worker;
+    std::atomic<bool> m_done{false};
+    std::chrono::steady_clock::time_point m_lastCheck;
+    std::vector<uint64_t> m_snapshot;
+    PlayersInfo m_compacted;
+};
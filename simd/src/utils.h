@@ -1,17 +1,50 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+#include <climits>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
 
 struct PlayerInfo {
     uint64_t player_id = 0; 
     uint64_t play_mask; // bits 0..59 represent numbers 1..60
 };
 
+// System tickets: 6 to 10 picked numbers covering every 5-number sub-combination.
+// Kept in their own arrays so the 5-number scan stays branch-free.
+struct SystemPlaysInfo {
+    std::vector<uint64_t> player_id;
+    std::vector<uint64_t> play_mask;  // same bit layout as PlayersInfo::play_mask
+    std::vector<uint8_t> pick_count;  // number of picked numbers (6..10)
+
+    // Same layout as PlayersInfo::tombstone
+    std::vector<uint64_t> tombstone;
+    size_t cancelled = 0;
+};
+
 // Structure of Arrays (SoA) representation for PlayerInfo
 struct PlayersInfo {
     std::vector<uint64_t> player_id;
     std::vector<uint64_t> play_mask; // bits 0..59 represent numbers 1..60
 
+    // Cancelled plays: bit (i % 64) of word i / 64 is set when play i is cancelled.
+    // Empty until the first cancellation; plays beyond its end are live.
+    std::vector<uint64_t> tombstone;
+    size_t cancelled = 0;
+
+    SystemPlaysInfo system;
+
+    // Dataset version, replaced by Utils::NextEpoch() when the dataset is loaded and every time
+    // plays are added or removed, so it identifies the dataset as well as its version.
+    // Anything derived from the arrays (e.g. cached draw results) must be tagged with it.
+    // 0 means the dataset was never versioned.
+    uint64_t epoch = 0;
 };
 
 class Utils {
@@ -34,6 +67,26 @@ public:
         return true;
     }
 
+    /*
+     * Ensures that a system play contains between six and ten distinct values
+     * within the valid range of 1 to 60 inclusive.
+     */
+    static bool ValidateSystemPlay(const std::vector<int>& play) {
+        if (play.size() < MinSystemPick || play.size() > MaxSystemPick) {
+            return false;
+        }
+
+        uint64_t seen = 0;
+        for (int number : play) {
+            if (number < MinNumber || number > MaxNumber || ((seen >> number) & 1) != 0) {
+                return false;
+            }
+            seen |= (1ULL << number);
+        }
+
+        return true;
+    }
+
     /*
      * Transforms the input vector into a bitmap (mask), mapping each number N
      * to the corresponding bit position representing N.
@@ -46,7 +99,95 @@ public:
         }
     }
 
+    /*
+     * Ensures that a draw mask selects at most five numbers within 1 to 60. Match counts
+     * index the six-tier histograms, so a wider mask would count past their end.
+     */
+    static bool ValidateDrawMask(uint64_t mask) {
+        const uint64_t numbers = (~0ULL >> (63 - MaxNumber)) & (~0ULL << MinNumber);
+        return (mask & ~numbers) == 0 && __builtin_popcountll(mask) <= 5;
+    }
+
+    static bool IsCancelled(const std::vector<uint64_t>& tombstone, size_t index) {
+        const size_t word = index / 64;
+        return word < tombstone.size() && ((tombstone[word] >> (index % 64)) & 1) != 0;
+    }
+
+    static bool IsCancelled(const PlayersInfo& data, size_t index) {
+        return IsCancelled(data.tombstone, index);
+    }
+
+    // Bounds [begin, end) of the shardIndex-th of shardCount equal ranges of the player IDs firstId..lastId
+    static std::pair<uint64_t, uint64_t> ShardIdRange(uint64_t firstId, uint64_t lastId, size_t shardIndex, size_t shardCount) {
+        const uint64_t span = lastId - firstId + 1;
+        return {firstId + span * shardIndex / shardCount, firstId + span * (shardIndex + 1) / shardCount};
+    }
+
+    // Epochs are unique within the process: two datasets only share one when one is a copy of the other
+    static uint64_t NextEpoch() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Bumps the futex word and wakes up to count of its waiters (background threads sleep on these
+    // rather than on a condition variable, so the submitting thread never takes a lock)
+    static void FutexWake(std::atomic<uint32_t>& word, int count) {
+        word.fetch_add(1);
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    // Sleeps unless word moved past observed; spurious returns are fine, callers re-check
+    static void FutexWait(std::atomic<uint32_t>& word, uint32_t observed) {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, observed, nullptr, nullptr, 0);
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain 32-bit integers");
+
+    // Moves the calling thread to SCHED_BATCH: waking it no longer preempts the thread that woke it,
+    // which matters when both share a core. Unprivileged; threads it starts inherit the policy.
+    static void RunAsBackground() {
+        sched_param param{};
+        ::pthread_setschedparam(::pthread_self(), SCHED_BATCH, &param);
+    }
+
+    static constexpr int Binomial(int n, int k) {
+        if (k < 0 || n < 0 || k > n) {
+            return 0;
+        }
+        int result = 1;
+        for (int i = 1; i <= k; ++i) {
+            result = result * (n - k + i) / i;
+        }
+        return result;
+    }
+
+    static constexpr size_t MinSystemPick = 6;
+    static constexpr size_t MaxSystemPick = 10;
+
 private:
     static constexpr int MinNumber = 1;
     static constexpr int MaxNumber = 60;
-};
\ No newline at end of file
+};
+
+/*
+ * Tier distribution of system tickets: count[n][m][k] is the number of 5-number combinations
+ * out of n picked numbers with k matches, when m of the picked numbers were drawn.
+ */
+struct SystemTierTable {
+    int count[Utils::MaxSystemPick + 1][6][6] = {};
+};
+
+constexpr SystemTierTable MakeSystemTierTable() {
+    SystemTierTable table;
+    for (size_t n = 0; n <= Utils::MaxSystemPick; ++n) {
+        for (int m = 0; m <= 5 && m <= static_cast<int>(n); ++m) {
+            for (int k = 0; k <= 5; ++k) {
+                // choose k of the m drawn numbers and 5-k of the n-m others
+                table.count[n][m][k] = Utils::Binomial(m, k) * Utils::Binomial(static_cast<int>(n) - m, 5 - k);
+            }
+        }
+    }
+    return table;
+}
+
+inline constexpr SystemTierTable SystemTiers = MakeSystemTierTable();
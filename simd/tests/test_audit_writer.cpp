@@ -0,0 +1,295 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "../src/audit_writer.h"
+#include "../src/lottery_processor.h"
+#include "test_data.h"
+
+struct ParsedRecord {
+    AuditWriter::AuditRecord record; // head of the draw's first record
+    std::vector<uint64_t> winners;   // concatenated over all of the draw's records
+    size_t records = 0;
+};
+
+// Parses an audit log back into one entry per draw, checking the framing along the way
+static std::vector<ParsedRecord> readAuditLog(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    std::vector<ParsedRecord> records;
+    size_t offset = 0;
+    while (offset + sizeof(AuditWriter::AuditRecord) <= bytes.size()) {
+        ParsedRecord parsed;
+        std::memcpy(&parsed.record, bytes.data() + offset, sizeof(parsed.record));
+        EXPECT_EQ(std::memcmp(parsed.record.magic, "LOTAUDIT", 8), 0);
+        EXPECT_EQ(parsed.record.recordBytes % AuditWriter::BlockSize, 0u);
+        if (parsed.record.recordBytes == 0) {
+            break;
+        }
+
+        parsed.winners.resize(parsed.record.winnerCount);
+        std::memcpy(parsed.winners.data(), bytes.data() + offset + sizeof(parsed.record),
+                    parsed.winners.size() * sizeof(uint64_t));
+        offset += parsed.record.recordBytes;
+
+        // Continuation records carry the same sequence and follow in part order
+        if (parsed.record.part != 0) {
+            EXPECT_FALSE(records.empty());
+            if (records.empty()) break;
+            ParsedRecord& draw = records.back();
+            EXPECT_EQ(parsed.record.sequence, draw.record.sequence);
+            EXPECT_EQ(parsed.record.part, draw.records);
+            EXPECT_EQ(parsed.record.parts, draw.record.parts);
+            draw.winners.insert(draw.winners.end(), parsed.winners.begin(), parsed.winners.end());
+            draw.records++;
+            continue;
+        }
+        parsed.records = 1;
+        records.emplace_back(parsed);
+    }
+    for (const auto& draw : records) {
+        EXPECT_EQ(draw.records, draw.record.parts);
+    }
+    EXPECT_EQ(offset, bytes.size());
+    return records;
+}
+
+static void writeAndVerify(const AuditWriter::Options& options) {
+    std::string tmpPath = "/tmp/audit_writer_test_" + std::to_string(::getpid()) + ".log";
+    std::remove(tmpPath.c_str());
+
+    AuditWriter writer(options);
+    ASSERT_TRUE(writer.Open(tmpPath));
+
+    // More records than buffers, so the draw side also has to wait for buffers to come back
+    std::vector<std::vector<uint64_t>> winnerLists;
+    for (uint64_t i = 0; i < 50; ++i) {
+        AuditWriter::AuditRecord record;
+        record.drawMask = i << 1;
+        record.epoch = 7;
+        record.winners[5] = static_cast<int64_t>(i);
+
+        std::vector<uint64_t> winners;
+        for (uint64_t w = 0; w < i * 37; ++w) {
+            winners.emplace_back(i * 1000 + w);
+        }
+        winnerLists.emplace_back(winners);
+        EXPECT_EQ(writer.Submit(record, std::move(winners)), i + 1);
+    }
+
+    ASSERT_TRUE(writer.WaitDurable(50));
+    EXPECT_EQ(writer.DurableSequence(), 50u);
+    AuditWriter::Stats stats = writer.GetStats();
+    EXPECT_EQ(stats.records, 50u);
+    EXPECT_GE(stats.fsyncs, 50u / options.fsyncBatch);
+    writer.Close();
+
+    std::vector<ParsedRecord> records = readAuditLog(tmpPath);
+    ASSERT_EQ(records.size(), 50u);
+    for (uint64_t i = 0; i < 50; ++i) {
+        EXPECT_EQ(records[i].record.sequence, i + 1);
+        EXPECT_EQ(records[i].record.drawMask, i << 1);
+        EXPECT_EQ(records[i].record.epoch, 7u);
+        EXPECT_EQ(records[i].record.winners[5], static_cast<int64_t>(i));
+        EXPECT_EQ(records[i].winners, winnerLists[i]);
+    }
+
+    std::remove(tmpPath.c_str());
+}
+
+TEST(AuditWriterTest, WritesRecordsInOrderWithIoUring) {
+    AuditWriter::Options options;
+    options.slots = 4;
+    options.maxWinners = 2048;
+    options.fsyncBatch = 3;
+    writeAndVerify(options);
+}
+
+TEST(AuditWriterTest, WritesRecordsInOrderWithPwrite) {
+    AuditWriter::Options options;
+    options.useIoUring = false;
+    options.slots = 4;
+    options.maxWinners = 2048;
+    writeAndVerify(options);
+}
+
+TEST(AuditWriterTest, WritesRecordsInOrderWithDirectIo) {
+    AuditWriter::Options options;
+    options.directIo = true;
+    options.maxWinners = 2048;
+    writeAndVerify(options);
+}
+
+TEST(AuditWriterTest, AppendsToExistingLogAndSplitsLongWinnerLists) {
+    std::string tmpPath = "/tmp/audit_writer_test_" + std::to_string(::getpid()) + ".log";
+    std::remove(tmpPath.c_str());
+
+    std::vector<uint64_t> longList;
+    for (uint64_t id = 1; id <= 25; ++id) {
+        longList.emplace_back(id);
+    }
+
+    AuditWriter::Options options;
+    options.maxWinners = 10;
+    options.fsyncBatch = 2; // fewer buffers than the long list needs records
+    for (int run = 0; run < 2; ++run) {
+        AuditWriter writer(options);
+        ASSERT_TRUE(writer.Open(tmpPath));
+        EXPECT_EQ(writer.Submit(AuditWriter::AuditRecord(), std::vector<uint64_t>(longList)), 1u);
+        EXPECT_EQ(writer.Submit(AuditWriter::AuditRecord(), {1, 2, 3}), 2u);
+        EXPECT_EQ(writer.Submit(AuditWriter::AuditRecord(), {}), 3u);
+        ASSERT_TRUE(writer.WaitDurable(3));
+        EXPECT_EQ(writer.GetStats().records, 5u);
+        EXPECT_EQ(writer.GetStats().winners, 28u);
+    }
+
+    std::vector<ParsedRecord> records = readAuditLog(tmpPath);
+    ASSERT_EQ(records.size(), 6u);
+    for (size_t run = 0; run < 2; ++run) {
+        EXPECT_EQ(records[run * 3].record.parts, 3u);
+        EXPECT_EQ(records[run * 3].winners, longList);
+        EXPECT_EQ(records[run * 3 + 1].winners, std::vector<uint64_t>({1, 2, 3}));
+        EXPECT_TRUE(records[run * 3 + 2].winners.empty());
+    }
+
+    std::remove(tmpPath.c_str());
+}
+
+TEST(AuditWriterTest, ReportsWriteFailuresAndReopens) {
+    std::string tmpPath = "/tmp/audit_writer_test_" + std::to_string(::getpid()) + ".log";
+    std::remove(tmpPath.c_str());
+
+    for (bool useIoUring : {true, false}) {
+        AuditWriter::Options options;
+        options.useIoUring = useIoUring;
+        options.fsyncBatch = 1;
+        AuditWriter writer(options);
+
+        // Every write to /dev/full fails with ENOSPC: no draw may ever be reported durable
+        ASSERT_TRUE(writer.Open("/dev/full"));
+        std::vector<uint64_t> sequences;
+        for (int i = 0; i < 5; ++i) {
+            sequences.emplace_back(writer.Submit(AuditWriter::AuditRecord(), {1, 2, 3}));
+        }
+        EXPECT_EQ(sequences[0], 1u);
+        for (uint64_t sequence : sequences) {
+            if (sequence != 0) {
+                EXPECT_FALSE(writer.WaitDurable(sequence)) << "sequence " << sequence;
+            }
+        }
+        EXPECT_EQ(writer.DurableSequence(), 0u);
+        EXPECT_EQ(writer.Submit(AuditWriter::AuditRecord(), {1}), 0u);
+        writer.Close();
+
+        // Reopened on a working file, the writer starts over
+        ASSERT_TRUE(writer.Open(tmpPath));
+        EXPECT_EQ(writer.Submit(AuditWriter::AuditRecord(), {4, 5}), 1u);
+        EXPECT_EQ(writer.Submit(AuditWriter::AuditRecord(), {6}), 2u);
+        ASSERT_TRUE(writer.WaitDurable(2));
+        EXPECT_EQ(writer.DurableSequence(), 2u);
+        writer.Close();
+
+        std::vector<ParsedRecord> records = readAuditLog(tmpPath);
+        ASSERT_EQ(records.size(), 2u);
+        EXPECT_EQ(records[0].winners, std::vector<uint64_t>({4, 5}));
+        EXPECT_EQ(records[1].winners, std::vector<uint64_t>({6}));
+        std::remove(tmpPath.c_str());
+    }
+}
+
+TEST(AuditWriterTest, CollectsWinnersOnTheWriterThread) {
+    std::string tmpPath = "/tmp/audit_writer_test_" + std::to_string(::getpid()) + ".log";
+    std::remove(tmpPath.c_str());
+
+    PlayersInfo data = createTestData(200'000, 41, 2'000);
+    AuditWriter::Options options;
+    options.maxWinners = 1'000;
+    AuditWriter writer(options);
+    ASSERT_TRUE(writer.Open(tmpPath));
+
+    std::mt19937 rng(47);
+    std::vector<uint64_t> draws;
+    for (size_t i = 0; i < 20; ++i) {
+        AuditWriter::AuditRecord record;
+        record.drawMask = randomDraw(rng);
+        draws.emplace_back(record.drawMask);
+        EXPECT_EQ(writer.Submit(record, data, 2), i + 1);
+    }
+    ASSERT_TRUE(writer.WaitDurable(20));
+    writer.Close();
+
+    LotteryProcessor lp;
+    std::vector<ParsedRecord> records = readAuditLog(tmpPath);
+    ASSERT_EQ(records.size(), 20u);
+    for (size_t i = 0; i < 20; ++i) {
+        std::vector<uint64_t> expected;
+        lp.CollectWinners(data, draws[i], 2, expected);
+        EXPECT_GT(records[i].record.parts, 1u);
+        EXPECT_EQ(records[i].winners, expected);
+    }
+
+    std::remove(tmpPath.c_str());
+}
+
+TEST(AuditWriterTest, ValidatingDrawToDurableLatencyWith1MPlays) {
+    std::string tmpPath = "/tmp/audit_writer_test_" + std::to_string(::getpid()) + ".log";
+    std::remove(tmpPath.c_str());
+
+    PlayersInfo data = createTestData(1'000'000, 41);
+    LotteryProcessor lp;
+    AuditWriter writer;
+    ASSERT_TRUE(writer.Open(tmpPath));
+
+    std::mt19937 rng(43);
+    std::vector<uint64_t> handOffTimes;
+    std::vector<uint64_t> durableTimes;
+    for (size_t i = 0; i < 200; ++i) {
+        const uint64_t pickedNumMask = randomDraw(rng);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        AuditWriter::AuditRecord record;
+        record.drawMask = pickedNumMask;
+        record.epoch = data.epoch;
+        LotteryProcessor::DrawResult result = lp.Count(data, pickedNumMask);
+        std::copy(result.winners, result.winners + 6, record.winners);
+
+        // The winner scan runs on the writer thread, off the draw path
+        auto handOff = std::chrono::high_resolution_clock::now();
+        uint64_t sequence = writer.Submit(record, data, 2);
+        auto handedOff = std::chrono::high_resolution_clock::now();
+        ASSERT_TRUE(writer.WaitDurable(sequence));
+        auto durable = std::chrono::high_resolution_clock::now();
+
+        handOffTimes.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(handedOff - handOff).count());
+        durableTimes.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(durable - start).count());
+    }
+    writer.Close();
+
+    std::sort(handOffTimes.begin(), handOffTimes.end());
+    std::sort(durableTimes.begin(), durableTimes.end());
+    uint64_t percentile50 = durableTimes.size() * 50 / 100;
+    uint64_t percentile90 = durableTimes.size() * 90 / 100;
+
+    std::cout << "Draw-to-durable latency for 1 million plays (" << (writer.UsingIoUring() ? "io_uring" : "pwrite") << "): "
+              << "hand-off p50 (" << handOffTimes[percentile50] << " us) "
+              << "p90 (" << handOffTimes[percentile90] << " us), "
+              << "durable p50 (" << durableTimes[percentile50] << " us) "
+              << "p90 (" << durableTimes[percentile90] << " us)" << std::endl;
+    // The draw path only fills a request head and pushes its pointer. On a single core the woken
+    // writer can preempt Submit and run its winner scan first, so the tail is only bounded with more
+    EXPECT_LT(handOffTimes[percentile50], 100);
+    if (std::thread::hardware_concurrency() > 1) {
+        EXPECT_LT(handOffTimes[percentile90], 100);
+    }
+
+    std::remove(tmpPath.c_str());
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+
+#include "../src/autotuner.h"
+#include "test_data.h"
+
+TEST(AutotunerTest, TunesAndPersistsProfile) {
+    std::string tmpPath = "/tmp/autotuner_test_" + std::to_string(::getpid()) + ".txt";
+    std::remove(tmpPath.c_str());
+
+    PlayersInfo data = createTestData(200'000, 99);
+    Autotuner::Options options;
+    options.warmupRuns = 1;
+    options.measuredRuns = 5;
+    Autotuner tuner(options);
+
+    testing::internal::CaptureStdout();
+    LotteryProcessor::Config tuned = tuner.LoadOrTune(tmpPath, data);
+    LotteryProcessor::Config loaded = tuner.LoadOrTune(tmpPath, data);
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_NE(output.find("Autotuned: "), std::string::npos);
+    EXPECT_NE(output.find("Loaded tuning profile: "), std::string::npos);
+    EXPECT_GE(tuned.threads, 1u);
+    EXPECT_EQ(loaded.threads, tuned.threads);
+    EXPECT_EQ(loaded.chunkSize, tuned.chunkSize);
+    EXPECT_EQ(loaded.kernel, tuned.kernel);
+    EXPECT_EQ(loaded.prefetchDistance, tuned.prefetchDistance);
+
+    // A differently sized dataset has its own entry
+    LotteryProcessor::Config other;
+    EXPECT_FALSE(Autotuner::LoadProfile(tmpPath, Autotuner::CpuModel(), Autotuner::SizeBucket(1000), other));
+
+    // Clean up temporary file
+    std::remove(tmpPath.c_str());
+}
+
+TEST(AutotunerTest, KeepsOtherProfileEntries) {
+    std::string tmpPath = "/tmp/autotuner_test_" + std::to_string(::getpid()) + ".txt";
+    std::remove(tmpPath.c_str());
+
+    LotteryProcessor::Config first;
+    first.threads = 2;
+    first.chunkSize = 65536;
+    first.kernel = LotteryProcessor::Kernel::Scalar;
+    LotteryProcessor::Config second;
+    second.threads = 8;
+
+    ASSERT_TRUE(Autotuner::SaveProfile(tmpPath, "cpu A", 20, first));
+    ASSERT_TRUE(Autotuner::SaveProfile(tmpPath, "cpu B", 20, second));
+    ASSERT_TRUE(Autotuner::SaveProfile(tmpPath, "cpu A", 20, first));
+
+    LotteryProcessor::Config config;
+    ASSERT_TRUE(Autotuner::LoadProfile(tmpPath, "cpu A", 20, config));
+    EXPECT_EQ(config.threads, 2u);
+    EXPECT_EQ(config.chunkSize, 65536u);
+    EXPECT_EQ(config.kernel, LotteryProcessor::Kernel::Scalar);
+    ASSERT_TRUE(Autotuner::LoadProfile(tmpPath, "cpu B", 20, config));
+    EXPECT_EQ(config.threads, 8u);
+
+    std::ifstream ifs(tmpPath);
+    size_t lines = 0;
+    std::string line;
+    while (std::getline(ifs, line)) lines++;
+    EXPECT_EQ(lines, 2u);
+
+    // Clean up temporary file
+    std::remove(tmpPath.c_str());
+}
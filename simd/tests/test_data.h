@@ -0,0 +1,88 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include "../src/utils.h"
+
+// Random 5-number plays with IDs 1..plays followed by system tickets of 6..10 numbers
+// (IDs plays+1..). The same seed always produces the same dataset.
+inline PlayersInfo createTestData(size_t plays, unsigned seed, size_t systemPlays = 0) {
+    PlayersInfo data;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(1, 60);
+    std::uniform_int_distribution<int> picks(Utils::MinSystemPick, Utils::MaxSystemPick);
+
+    for (size_t i = 0; i < plays; ++i) {
+        uint64_t mask = 0;
+        while (__builtin_popcountll(mask) < 5) {
+            mask |= (1ULL << dist(rng));
+        }
+        data.player_id.emplace_back(i + 1);
+        data.play_mask.emplace_back(mask);
+    }
+
+    for (size_t i = 0; i < systemPlays; ++i) {
+        const int pickCount = picks(rng);
+        uint64_t mask = 0;
+        while (__builtin_popcountll(mask) < pickCount) {
+            mask |= (1ULL << dist(rng));
+        }
+        data.system.player_id.emplace_back(plays + i + 1);
+        data.system.play_mask.emplace_back(mask);
+        data.system.pick_count.emplace_back(static_cast<uint8_t>(pickCount));
+    }
+
+    data.epoch = Utils::NextEpoch();
+    return data;
+}
+
+// Reference: every live system ticket expanded into its 5-number combinations
+inline PlayersInfo expandSystemPlays(const PlayersInfo& data) {
+    PlayersInfo expanded;
+    for (size_t i = 0; i < data.play_mask.size(); ++i) {
+        if (!Utils::IsCancelled(data, i)) {
+            expanded.player_id.emplace_back(data.player_id[i]);
+            expanded.play_mask.emplace_back(data.play_mask[i]);
+        }
+    }
+
+    const SystemPlaysInfo& system = data.system;
+    for (size_t i = 0; i < system.play_mask.size(); ++i) {
+        if (Utils::IsCancelled(system.tombstone, i)) {
+            continue;
+        }
+
+        std::vector<int> bits;
+        for (int bit = 1; bit <= 60; ++bit) {
+            if ((system.play_mask[i] >> bit) & 1) {
+                bits.emplace_back(bit);
+            }
+        }
+        for (uint32_t subset = 0; subset < (1u << bits.size()); ++subset) {
+            if (__builtin_popcount(subset) != 5) {
+                continue;
+            }
+            uint64_t mask = 0;
+            for (size_t b = 0; b < bits.size(); ++b) {
+                if ((subset >> b) & 1) {
+                    mask |= 1ULL << bits[b];
+                }
+            }
+            expanded.player_id.emplace_back(system.player_id[i]);
+            expanded.play_mask.emplace_back(mask);
+        }
+    }
+
+    return expanded;
+}
+
+// Random draw of 5 distinct numbers
+inline uint64_t randomDraw(std::mt19937& rng) {
+    std::uniform_int_distribution<int> dist(1, 60);
+    uint64_t mask = 0;
+    while (__builtin_popcountll(mask) < 5) {
+        mask |= (1ULL << dist(rng));
+    }
+    return mask;
+}
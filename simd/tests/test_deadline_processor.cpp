@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <future>
+#include <algorithm>
+
+#include "../src/deadline_processor.h"
+#include "../src/ticket_cancellation.h"
+#include "test_data.h"
+
+TEST(DeadlineProcessorTest, ExactWhenTheBudgetSuffices) {
+    PlayersInfo data = createTestData(100'003, 47, 10'007);
+    TicketCancellation::Cancel(data, {1, 50'000, 100'010});
+
+    LotteryProcessor lp;
+    DeadlineProcessor processor(data);
+    std::mt19937 rng(53);
+    for (int i = 0; i < 5; ++i) {
+        const uint64_t pickedNumMask = randomDraw(rng);
+        std::future<LotteryProcessor::DrawResult> exact;
+        DeadlineProcessor::Estimate estimate = processor.Process(pickedNumMask, std::chrono::seconds(10), exact);
+        LotteryProcessor::DrawResult expected = lp.Count(data, pickedNumMask);
+
+        EXPECT_TRUE(estimate.exact);
+        EXPECT_EQ(estimate.sampledFraction, 1.0);
+        LotteryProcessor::DrawResult result = exact.get();
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(estimate.winners.winners[n], expected.winners[n]);
+            EXPECT_EQ(estimate.low[n], expected.winners[n]);
+            EXPECT_EQ(estimate.high[n], expected.winners[n]);
+            EXPECT_EQ(result.winners[n], expected.winners[n]);
+        }
+    }
+}
+
+TEST(DeadlineProcessorTest, IntervalsCoverTheExactResult) {
+    PlayersInfo data = createTestData(1'000'000, 47, 100'000);
+    LotteryProcessor lp;
+    DeadlineProcessor::Options options;
+    options.blockSize = 1024;
+    DeadlineProcessor processor(data, options);
+    std::mt19937 rng(59);
+
+    // An already expired deadline still scans nothing but the partial blocks: the bounds must hold
+    std::future<LotteryProcessor::DrawResult> exact;
+    DeadlineProcessor::Estimate expired = processor.Process(randomDraw(rng), std::chrono::steady_clock::now(), exact);
+    EXPECT_FALSE(expired.exact);
+    EXPECT_EQ(expired.sampledFraction, 0.0);
+    LotteryProcessor::DrawResult expiredExact = exact.get();
+    for (int n = 0; n < 6; ++n) {
+        EXPECT_LE(expired.low[n], expiredExact.winners[n]);
+        EXPECT_GE(expired.high[n], expiredExact.winners[n]);
+    }
+
+    // Count how often the ~95% intervals of the common tiers contain the exact count
+    int checked = 0;
+    int covered = 0;
+    for (int i = 0; i < 40; ++i) {
+        const uint64_t pickedNumMask = randomDraw(rng);
+        DeadlineProcessor::Estimate estimate = processor.Process(pickedNumMask, std::chrono::microseconds(500), exact);
+        LotteryProcessor::DrawResult result = exact.get();
+        LotteryProcessor::DrawResult expected = lp.Count(data, pickedNumMask);
+
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], expected.winners[n]);
+        }
+        if (estimate.exact) {
+            continue;
+        }
+        EXPECT_GT(estimate.sampledFraction, 0.0);
+        for (int n = 0; n <= 2; ++n) {
+            checked++;
+            covered += estimate.low[n] <= expected.winners[n] && expected.winners[n] <= estimate.high[n];
+            EXPECT_LE(estimate.low[n], estimate.winners.winners[n]);
+            EXPECT_GE(estimate.high[n], estimate.winners.winners[n]);
+        }
+    }
+
+    if (checked > 0) {
+        EXPECT_GE(covered, checked * 8 / 10) << covered << " of " << checked << " intervals covered the exact count";
+    }
+}
+
+TEST(DeadlineProcessorTest, RareTierIntervalsCoverTheExactResult) {
+    PlayersInfo data = createTestData(1'000'000, 67);
+    LotteryProcessor lp;
+    DeadlineProcessor::Options options;
+    options.blockSize = 1024;
+    DeadlineProcessor processor(data, options);
+    std::mt19937 rng(71);
+    std::uniform_int_distribution<size_t> index(0, data.play_mask.size() - 1);
+
+    // A handful of 4- and 5-match plays per draw: most samples see none of them
+    int checked = 0;
+    int covered = 0;
+    for (int i = 0; i < 40; ++i) {
+        const uint64_t pickedNumMask = randomDraw(rng);
+        const uint64_t fourOfFive = pickedNumMask & (pickedNumMask - 1);
+        for (int planted = 0; planted < i % 4; ++planted) {
+            data.play_mask[index(rng)] = pickedNumMask;
+            const uint64_t others = randomDraw(rng) & ~pickedNumMask;
+            data.play_mask[index(rng)] = fourOfFive | (others & (0 - others));
+        }
+
+        std::future<LotteryProcessor::DrawResult> exact;
+        DeadlineProcessor::Estimate estimate = processor.Process(pickedNumMask, std::chrono::microseconds(500), exact);
+        LotteryProcessor::DrawResult result = exact.get();
+        LotteryProcessor::DrawResult expected = lp.Count(data, pickedNumMask);
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], expected.winners[n]);
+        }
+        if (estimate.exact) {
+            continue;
+        }
+
+        for (int n = 3; n <= 5; ++n) {
+            checked++;
+            covered += estimate.low[n] <= expected.winners[n] && expected.winners[n] <= estimate.high[n];
+            EXPECT_LT(estimate.low[n], estimate.high[n]) << "tier " << n << " got a zero-width interval";
+        }
+    }
+
+    if (checked > 0) {
+        EXPECT_GE(covered, checked * 9 / 10) << covered << " of " << checked << " rare-tier intervals covered the exact count";
+    }
+}
+
+TEST(DeadlineProcessorTest, ValidatingEstimateTimeWith1MPlaysAnd100usBudget) {
+    PlayersInfo data = createTestData(1'000'000, 47);
+    DeadlineProcessor processor(data);
+    std::mt19937 rng(61);
+
+    // Draws back to back: the exact passes of earlier draws are still running in the background
+    std::vector<uint64_t> perfTimes;
+    std::vector<double> relativeWidths;
+    std::vector<std::future<LotteryProcessor::DrawResult>> exacts(200);
+    for (size_t i = 0; i < exacts.size(); ++i) {
+        const uint64_t pickedNumMask = randomDraw(rng);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        DeadlineProcessor::Estimate estimate = processor.Process(pickedNumMask, std::chrono::microseconds(100), exacts[i]);
+        auto end = std::chrono::high_resolution_clock::now();
+        perfTimes.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        relativeWidths.emplace_back((estimate.high[2] - estimate.low[2]) / std::max<int64_t>(1, estimate.winners.winners[2]));
+    }
+    for (auto& exact : exacts) {
+        exact.wait();
+    }
+
+    std::sort(perfTimes.begin(), perfTimes.end());
+    std::sort(relativeWidths.begin(), relativeWidths.end());
+    uint64_t percentile50 = perfTimes.size() * 50 / 100;
+    uint64_t percentile90 = perfTimes.size() * 90 / 100;
+
+    std::cout << "Estimate time for 1 million plays with a 100 us budget: "
+              << "p50 (" << perfTimes[percentile50] << " us) "
+              << "p90 (" << perfTimes[percentile90] << " us), "
+              << "overshoot p90 (" << static_cast<int64_t>(perfTimes[percentile90]) - 100 << " us), "
+              << "2-match interval width p50 (" << relativeWidths[percentile50] * 100 << "%)" << std::endl;
+    EXPECT_LT(perfTimes[percentile90], 1'000); // Expect the estimate well within a millisecond
+}
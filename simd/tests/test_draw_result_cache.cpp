@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "../src/draw_result_cache.h"
+#include "../src/shard_server.h"
+#include "test_data.h"
+
+TEST(DrawResultCacheTest, ServesRepeatedDrawsFromCache) {
+    PlayersInfo data = createTestData(10'000, 42);
+    LotteryProcessor lp;
+    CachedLotteryProcessor cached;
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+    LotteryProcessor::DrawResult expected = lp.Count(data, pickedNumMask);
+
+    for (int i = 0; i < 3; ++i) {
+        LotteryProcessor::DrawResult result = cached.Count(data, pickedNumMask);
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], expected.winners[n]);
+        }
+    }
+
+    DrawResultCache::Stats stats = cached.GetStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.inserts, 1u);
+}
+
+TEST(DrawResultCacheTest, NeverServesStaleEpoch) {
+    PlayersInfo data = createTestData(1'000, 42);
+    CachedLotteryProcessor cached;
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 2, 3, 4, 5}, pickedNumMask);
+    LotteryProcessor::DrawResult before = cached.Count(data, pickedNumMask);
+
+    // Adding a jackpot play must be visible on the next draw
+    data.player_id.emplace_back(data.player_id.size() + 1);
+    data.play_mask.emplace_back(pickedNumMask);
+    data.epoch = Utils::NextEpoch();
+
+    LotteryProcessor::DrawResult after = cached.Count(data, pickedNumMask);
+    EXPECT_EQ(after.winners[5], before.winners[5] + 1);
+
+    DrawResultCache::Stats stats = cached.GetStats();
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.evictions, 1u);
+}
+
+TEST(DrawResultCacheTest, NeverServesAnotherDatasetsResult) {
+    PlayersInfo data = createTestData(10'000, 42);
+    CachedLotteryProcessor cached;
+    LotteryProcessor lp;
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+
+    // Shards of one dataset and an independently loaded dataset share the same cache
+    std::vector<PlayersInfo> datasets = {SplitByPlayerIdRange(data, 0, 2), SplitByPlayerIdRange(data, 1, 2),
+                                         createTestData(10'000, 43), createTestData(10'000, 42)};
+    for (const auto& dataset : datasets) {
+        LotteryProcessor::DrawResult expected = lp.Count(dataset, pickedNumMask);
+        for (int repeat = 0; repeat < 2; ++repeat) {
+            LotteryProcessor::DrawResult result = cached.Count(dataset, pickedNumMask);
+            for (int n = 0; n < 6; ++n) {
+                EXPECT_EQ(result.winners[n], expected.winners[n]) << "repeat " << repeat;
+            }
+        }
+    }
+
+    // An unversioned dataset is never cached
+    PlayersInfo unversioned = createTestData(1'000, 44);
+    unversioned.epoch = 0;
+    cached.Count(unversioned, pickedNumMask);
+
+    DrawResultCache::Stats stats = cached.GetStats();
+    EXPECT_EQ(stats.misses, datasets.size());
+    EXPECT_EQ(stats.hits, datasets.size());
+}
+
+TEST(DrawResultCacheTest, CountsEvictionsAndKeysByRuleset) {
+    DrawResultCache cache(1);
+    LotteryProcessor::DrawResult result;
+    result.winners[5] = 7;
+
+    cache.Insert(1, 0, 1, result);
+    cache.Insert(2, 0, 1, result);
+    EXPECT_FALSE(cache.Lookup(1, 0, 1, result));
+    EXPECT_TRUE(cache.Lookup(2, 0, 1, result));
+    EXPECT_EQ(result.winners[5], 7);
+    EXPECT_FALSE(cache.Lookup(2, 1, 1, result));
+
+    DrawResultCache::Stats stats = cache.GetStats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_DOUBLE_EQ(stats.HitRate(), 1.0 / 3.0);
+}
+
+TEST(DrawResultCacheTest, ValidatingHitLatency) {
+    PlayersInfo data = createTestData(1'000'000, 42);
+    CachedLotteryProcessor cached;
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+    cached.Count(data, pickedNumMask);
+
+    std::vector<uint64_t> perfTimes;
+    for (size_t i = 0; i < 10'000; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        LotteryProcessor::DrawResult result = cached.Count(data, pickedNumMask);
+        auto end = std::chrono::high_resolution_clock::now();
+        ASSERT_GE(result.winners[0], 0);
+
+        auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+        perfTimes.emplace_back(elapsed_ns.count());
+    }
+
+    std::sort(perfTimes.begin(), perfTimes.end());
+    uint64_t percentile50 = perfTimes.size() * 50 / 100;
+    uint64_t percentile90 = perfTimes.size() * 90 / 100;
+
+    std::cout << "Cache hit time for 1 million plays: "
+              << "p50 (" << perfTimes[percentile50] << " ns) "
+              << "p90 (" << perfTimes[percentile90] << " ns) "
+              << "hit rate (" << cached.GetStats().HitRate() << ")" << std::endl;
+    EXPECT_LT(perfTimes[percentile50], 10'000); // Expect hits to stay far below a full sweep
+}
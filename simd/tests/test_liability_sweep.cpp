@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+
+#include "../src/liability_sweep.h"
+#include "../src/ticket_cancellation.h"
+#include "test_data.h"
+
+TEST(LiabilitySweepTest, MatchesProcessForSampledDraws) {
+    PlayersInfo data = createTestData(50'000, 23);
+    // A play repeating a number is valid input and only has 4 distinct numbers
+    data.player_id.emplace_back(data.player_id.size() + 1);
+    Utils::SetPlayToMask({1, 1, 2, 3, 4}, data.play_mask.emplace_back());
+    TicketCancellation::Cancel(data, {10, 20, 30});
+
+    // Several threads even on a single core, so the per-thread subset tables get reduced
+    LiabilitySweep::Options options;
+    options.threads = 3;
+    LiabilitySweep sweep(options);
+    sweep.Aggregate(data);
+    LotteryProcessor lp;
+
+    std::mt19937 rng(29);
+    std::uniform_int_distribution<uint64_t> ranks(0, sweep.DrawCount() - 1);
+    std::vector<uint64_t> draws = {sweep.DrawMask(0), sweep.DrawMask(sweep.DrawCount() - 1)};
+    for (int i = 0; i < 200; ++i) {
+        draws.emplace_back(sweep.DrawMask(ranks(rng)));
+    }
+
+    for (uint64_t drawMask : draws) {
+        ASSERT_EQ(__builtin_popcountll(drawMask), 5);
+        LotteryProcessor::DrawResult expected = lp.Count(data, drawMask);
+        LotteryProcessor::DrawResult result = sweep.Evaluate(drawMask);
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], expected.winners[n]) << "draw mask " << drawMask;
+        }
+    }
+}
+
+TEST(LiabilitySweepTest, RejectsDrawMasksOutsideTheNumbers) {
+    PlayersInfo data = createTestData(1'000, 23);
+    LiabilitySweep sweep;
+    sweep.Aggregate(data);
+
+    // Five bits each, but bit 0 and bit 61 are not numbers; four numbers are not a draw either
+    uint64_t fourNumbers = 0;
+    Utils::SetPlayToMask({1, 2, 3, 4}, fourNumbers);
+    for (uint64_t drawMask : std::vector<uint64_t>{fourNumbers | 1ULL, fourNumbers | (1ULL << 61), fourNumbers}) {
+        LotteryProcessor::DrawResult result = sweep.Evaluate(drawMask);
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], 0) << "draw mask " << drawMask;
+        }
+    }
+}
+
+TEST(LiabilitySweepTest, StreamsRecordsAndReportsTopLiability) {
+    std::string tmpPath = "/tmp/liability_sweep_test_" + std::to_string(::getpid()) + ".bin";
+    PlayersInfo data = createTestData(10'000, 23);
+
+    LiabilitySweep::Options options;
+    options.threads = 2;
+    options.topK = 3;
+    options.prizes[5] = 1'000'000;
+    options.prizes[4] = 1'000;
+    options.outputPath = tmpPath;
+    LiabilitySweep sweep(options);
+    sweep.Aggregate(data);
+
+    // Draws 100'000..199'999 in colex order
+    std::vector<LiabilitySweep::DrawLiability> top;
+    ASSERT_TRUE(sweep.Run(100'000, 200'000, top));
+    ASSERT_EQ(top.size(), 3u);
+    EXPECT_GE(top[0].liability, top[1].liability);
+    EXPECT_GE(top[1].liability, top[2].liability);
+
+    // The best draw really is the most expensive one in the range
+    LotteryProcessor lp;
+    double best = 0;
+    for (uint64_t rank = 100'000; rank < 200'000; rank += 997) {
+        LotteryProcessor::DrawResult result = lp.Count(data, sweep.DrawMask(rank));
+        best = std::max(best, result.winners[5] * 1'000'000.0 + result.winners[4] * 1'000.0);
+    }
+    EXPECT_GE(top[0].liability, best);
+
+    std::ifstream ifs(tmpPath, std::ios::binary);
+    ASSERT_TRUE(ifs.is_open());
+    LiabilitySweep::FileHeader header;
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    EXPECT_EQ(std::string(header.magic, 8), "LOTSWEEP");
+    EXPECT_EQ(header.drawCount, 5'461'512u);
+    EXPECT_EQ(header.plays, 10'000u);
+
+    for (uint64_t rank : {100'000u, 150'123u, 199'999u}) {
+        LiabilitySweep::Record record;
+        ifs.seekg(sizeof(header) + rank * sizeof(record));
+        ifs.read(reinterpret_cast<char*>(&record), sizeof(record));
+        EXPECT_EQ(record.drawMask, sweep.DrawMask(rank));
+
+        LotteryProcessor::DrawResult expected = lp.Count(data, record.drawMask);
+        for (int k = 2; k <= 5; ++k) {
+            EXPECT_EQ(record.winners[k - 2], static_cast<uint64_t>(expected.winners[k]));
+        }
+    }
+
+    // Clean up temporary file
+    std::remove(tmpPath.c_str());
+}
+
+TEST(LiabilitySweepTest, TopZeroOnlyWritesRecords) {
+    std::string tmpPath = "/tmp/liability_sweep_top0_test_" + std::to_string(::getpid()) + ".bin";
+    PlayersInfo data = createTestData(1'000, 23);
+
+    LiabilitySweep::Options options;
+    options.threads = 2;
+    options.topK = 0;
+    options.prizes[5] = 1'000'000;
+    options.outputPath = tmpPath;
+    LiabilitySweep sweep(options);
+    sweep.Aggregate(data);
+
+    std::vector<LiabilitySweep::DrawLiability> top;
+    ASSERT_TRUE(sweep.Run(0, 50'000, top));
+    EXPECT_TRUE(top.empty());
+
+    std::ifstream ifs(tmpPath, std::ios::binary);
+    ASSERT_TRUE(ifs.is_open());
+    LiabilitySweep::Record record;
+    ifs.seekg(sizeof(LiabilitySweep::FileHeader) + 49'999 * sizeof(record));
+    ifs.read(reinterpret_cast<char*>(&record), sizeof(record));
+    EXPECT_EQ(record.drawMask, sweep.DrawMask(49'999));
+
+    // Clean up temporary file
+    std::remove(tmpPath.c_str());
+}
+
+TEST(LiabilitySweepTest, ValidatingFullSweepTimeWith1MPlays) {
+    PlayersInfo data = createTestData(1'000'000, 23);
+    LiabilitySweep::Options options;
+    options.prizes[2] = 2;
+    options.prizes[3] = 20;
+    options.prizes[4] = 1'000;
+    options.prizes[5] = 1'000'000;
+    LiabilitySweep sweep(options);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    sweep.Aggregate(data);
+    auto aggregated = std::chrono::high_resolution_clock::now();
+    std::vector<LiabilitySweep::DrawLiability> top;
+    ASSERT_TRUE(sweep.Run(top));
+    auto swept = std::chrono::high_resolution_clock::now();
+
+    auto aggregateMs = std::chrono::duration_cast<std::chrono::milliseconds>(aggregated - start).count();
+    auto sweepMs = std::chrono::duration_cast<std::chrono::milliseconds>(swept - aggregated).count();
+    std::cout << "Full draw-space sweep for 1 million plays: aggregate (" << aggregateMs << " ms) "
+              << "sweep of " << sweep.DrawCount() << " draws (" << sweepMs << " ms) "
+              << "worst-case liability (" << top[0].liability << ")" << std::endl;
+    EXPECT_LT(sweepMs, 60'000); // Expect the whole draw space in under a minute
+}
@@ -63,4 +63,32 @@ TEST(LotteryInputReaderTest, ReadsInvalidPlays) {
 
     // Clean up temporary file
     std::remove(tmpPath.c_str());
-}
\ No newline at end of file
+}
+
+TEST(LotteryInputReaderTest, ReadsSystemPlays) {
+    std::string tmpPath = "/tmp/input_reader_test_" + std::to_string(::getpid()) + ".txt";
+
+    std::ofstream ofs(tmpPath);
+    ASSERT_TRUE(ofs.is_open());
+    ofs << "1 2 3 4 5" << std::endl;
+    ofs << "1 2 3 4 5 6 7" << std::endl;
+    ofs << "1 2 3 4 5 6 7 8 9 10 11" << std::endl; // too many numbers
+    ofs << "1 2 3 4 5 5";                         // repeated number
+    ofs.close();
+
+    LotteryInputReader reader(tmpPath);
+    EXPECT_TRUE(reader.Read());
+
+    const auto& data = reader.GetData();
+    ASSERT_EQ(data.player_id.size(), 1u);
+    ASSERT_EQ(data.system.player_id.size(), 1u);
+    EXPECT_EQ(data.system.player_id[0], 2u);
+    EXPECT_EQ(data.system.pick_count[0], 7u);
+
+    uint64_t mask = 0;
+    Utils::SetPlayToMask({1, 2, 3, 4, 5, 6, 7}, mask);
+    EXPECT_EQ(data.system.play_mask[0], mask);
+
+    // Clean up temporary file
+    std::remove(tmpPath.c_str());
+}
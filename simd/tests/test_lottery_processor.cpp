@@ -7,6 +7,7 @@
 
 #include "../src/lottery_processor.h"
 #include "../src/lottery_input_reader.h"
+#include "test_data.h"
 
 std::string generateRandomPlay() {
     std::string play;
@@ -97,3 +98,61 @@ TEST(LotteryProcessorTest, ValidatingProcessingTimeWith1MPlays) {
     // Clean up temporary file
     std::remove(tmpPath.c_str());
 }
+
+TEST(LotteryProcessorTest, AllConfigurationsCountTheSame) {
+    PlayersInfo data = createTestData(100'003, 1234);
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+    LotteryProcessor reference;
+    LotteryProcessor::DrawResult expected = reference.Count(data, pickedNumMask);
+
+    for (auto kernel : LotteryProcessor::Kernels) {
+        for (unsigned int threads : {1u, 3u}) {
+            for (size_t chunkSize : {0, 1000}) {
+                LotteryProcessor::Config config;
+                config.threads = threads;
+                config.chunkSize = chunkSize;
+                config.kernel = kernel;
+                LotteryProcessor lp(config);
+
+                LotteryProcessor::DrawResult result = lp.Count(data, pickedNumMask);
+                for (int n = 0; n < 6; ++n) {
+                    EXPECT_EQ(result.winners[n], expected.winners[n]) << LotteryProcessor::KernelName(kernel)
+                        << " threads=" << threads << " chunk=" << chunkSize;
+                }
+            }
+        }
+    }
+}
+
+TEST(LotteryProcessorTest, KernelsHandleUnalignedRangesAndPrefetchDistances) {
+    PlayersInfo data = createTestData(1'000, 4321);
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+    LotteryProcessor::Config referenceConfig;
+    referenceConfig.kernel = LotteryProcessor::Kernel::Scalar;
+    LotteryProcessor reference(referenceConfig);
+
+    // Every start offset within a cache line, odd lengths, and prefetches reaching past the range
+    for (auto kernel : LotteryProcessor::Kernels) {
+        for (size_t distance : {0, 1, 512, 100'000}) {
+            LotteryProcessor::Config config;
+            config.kernel = kernel;
+            config.prefetchDistance = distance;
+            LotteryProcessor lp(config);
+
+            for (size_t start = 0; start < 8; ++start) {
+                for (size_t length : {0, 1, 7, 8, 9, 33, 991}) {
+                    LotteryProcessor::DrawResult result = lp.CountRange(data, start, start + length, 0, 0, pickedNumMask);
+                    LotteryProcessor::DrawResult expected = reference.CountRange(data, start, start + length, 0, 0, pickedNumMask);
+                    for (int n = 0; n < 6; ++n) {
+                        EXPECT_EQ(result.winners[n], expected.winners[n]) << LotteryProcessor::KernelName(kernel)
+                            << " distance=" << distance << " start=" << start << " length=" << length;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+
+#include "../src/perf_counters.h"
+#include "../src/lottery_processor.h"
+#include "test_data.h"
+
+TEST(PerfCountersTest, DegradesGracefully) {
+    PerfCounters counters;
+    counters.Start();
+    volatile uint64_t sink = 0;
+    for (int i = 0; i < 100'000; ++i) sink = sink + i;
+    PerfCounters::Sample sample = counters.Stop();
+
+    for (int e = 0; e < PerfCounters::EventCount; ++e) {
+        auto event = static_cast<PerfCounters::Event>(e);
+        EXPECT_EQ(sample.available[e], counters.Available(event));
+    }
+    if (sample.available[PerfCounters::Instructions]) {
+        EXPECT_GT(sample.values[PerfCounters::Instructions], 100'000u);
+    } else {
+        std::cout << PerfCounters::UnavailableReason() << std::endl;
+    }
+}
+
+TEST(PerfCountersTest, ReportsPerPlayCostWith1MPlays) {
+    PlayersInfo data = createTestData(1'000'000, 11);
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+    const size_t runs = 50;
+
+    for (auto kernel : LotteryProcessor::Kernels) {
+        LotteryProcessor::Config config;
+        config.kernel = kernel;
+        LotteryProcessor lp(config);
+        lp.Count(data, pickedNumMask); // warm-up
+
+        // Counters wrap exactly the Count calls, worker threads included
+        PerfCounters counters;
+        counters.Start();
+        for (size_t i = 0; i < runs; ++i) {
+            lp.Count(data, pickedNumMask);
+        }
+        PerfCounters::Sample sample = counters.Stop();
+
+        PerfCounters::PrintPerPlay(std::string("SIMD ") + LotteryProcessor::KernelName(kernel), sample, data.play_mask.size() * runs);
+    }
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+
+#include "../src/play_analytics.h"
+#include "../src/lottery_input_reader.h"
+#include "../src/ticket_cancellation.h"
+#include "test_data.h"
+
+// Brute-force tables over the live (not cancelled) plays, compared entry by entry
+static void expectBruteForceCounts(const PlayersInfo& data, const PlayAnalytics& analytics) {
+    std::vector<uint64_t> frequencies(61, 0);
+    std::vector<uint64_t> pairs(61 * 61, 0);
+    for (size_t i = 0; i < data.play_mask.size(); ++i) {
+        if (Utils::IsCancelled(data, i)) {
+            continue;
+        }
+        const uint64_t mask = data.play_mask[i];
+        for (int a = 1; a <= 60; ++a) {
+            if ((mask >> a) & 1) {
+                frequencies[a]++;
+                for (int b = 1; b <= 60; ++b) {
+                    if (b != a && ((mask >> b) & 1)) pairs[a * 61 + b]++;
+                }
+            }
+        }
+    }
+
+    std::vector<uint64_t> matrix = analytics.PairMatrix();
+    for (int a = 1; a <= 60; ++a) {
+        EXPECT_EQ(analytics.Frequency(a), frequencies[a]);
+        for (int b = 1; b <= 60; ++b) {
+            uint64_t expected = a == b ? frequencies[a] : pairs[a * 61 + b];
+            EXPECT_EQ(matrix[(a - 1) * 60 + (b - 1)], expected);
+        }
+    }
+}
+
+TEST(PlayAnalyticsTest, MatchesBruteForceCounts) {
+    PlayersInfo data = createTestData(300'000, 5);
+    PlayAnalytics analytics(4);
+    analytics.Update(data);
+    expectBruteForceCounts(data, analytics);
+}
+
+TEST(PlayAnalyticsTest, LeavesOutCancelledAndCompactedPlays) {
+    PlayersInfo data = createTestData(200'000, 5);
+    PlayAnalytics analytics;
+    analytics.Update(data);
+
+    std::vector<uint64_t> early;
+    std::vector<uint64_t> late;
+    for (uint64_t id = 1; id <= data.player_id.size(); id += 7) early.emplace_back(id);
+    for (uint64_t id = 3; id <= data.player_id.size(); id += 11) late.emplace_back(id);
+
+    TicketCancellation::Cancel(data, early);
+    analytics.Update(data);
+    expectBruteForceCounts(data, analytics);
+
+    // Compaction moves the plays: the next Update recounts the rebuilt arrays
+    BackgroundCompactor compactor;
+    ASSERT_TRUE(compactor.MaybeStart(data, 0.1));
+    TicketCancellation::Cancel(data, late);
+    ASSERT_TRUE(compactor.Publish(data));
+    analytics.Update(data);
+    EXPECT_EQ(analytics.ProcessedPlays(), data.play_mask.size());
+    expectBruteForceCounts(data, analytics);
+
+    // Plays cancelled in the compacted arrays are still taken out
+    TicketCancellation::Cancel(data, {2, 4, 6});
+    analytics.Update(data);
+    expectBruteForceCounts(data, analytics);
+}
+
+TEST(PlayAnalyticsTest, IncrementalUpdatesMatchFullPass) {
+    PlayersInfo data = createTestData(200'000, 5);
+    PlayAnalytics full;
+    full.Update(data);
+
+    PlayersInfo growing;
+    PlayAnalytics incremental;
+    for (size_t i = 0; i < data.play_mask.size(); ++i) {
+        growing.player_id.emplace_back(data.player_id[i]);
+        growing.play_mask.emplace_back(data.play_mask[i]);
+        if (i % 70'001 == 0) {
+            incremental.Update(growing);
+        }
+    }
+    incremental.Update(growing);
+
+    EXPECT_EQ(incremental.ProcessedPlays(), data.play_mask.size());
+    EXPECT_EQ(incremental.PairMatrix(), full.PairMatrix());
+}
+
+TEST(PlayAnalyticsTest, CountsSystemTicketsAsTheirCoveredPlays) {
+    PlayersInfo data = createTestData(20'000, 5, 3'000);
+    PlayAnalytics analytics;
+
+    auto expectExpandedCounts = [&]() {
+        analytics.Update(data);
+        PlayAnalytics expected;
+        expected.Update(expandSystemPlays(data));
+        EXPECT_EQ(analytics.PairMatrix(), expected.PairMatrix());
+    };
+
+    expectExpandedCounts();
+
+    // Cancelled system tickets leave the tables, and compaction moves both arrays
+    TicketCancellation::Cancel(data, {7, 20'005, 20'100});
+    expectExpandedCounts();
+    data = TicketCancellation::Compact(data);
+    expectExpandedCounts();
+    EXPECT_EQ(analytics.ProcessedSystemPlays(), 2'998u);
+}
+
+TEST(PlayAnalyticsTest, UpdatedByReaderWhileLoading) {
+    std::string tmpPath = "/tmp/play_analytics_test_" + std::to_string(::getpid()) + ".txt";
+
+    std::ofstream ofs(tmpPath);
+    ASSERT_TRUE(ofs.is_open());
+    ofs << "1 2 3 4 5" << std::endl;
+    ofs << "1 2 10 11 12" << std::endl;
+    ofs << "10 20 30 40 50";
+    ofs.close();
+
+    PlayAnalytics analytics;
+    LotteryInputReader reader(tmpPath);
+    reader.AttachAnalytics(&analytics);
+    EXPECT_TRUE(reader.Read());
+
+    EXPECT_EQ(analytics.ProcessedPlays(), 3u);
+    EXPECT_EQ(analytics.Frequency(1), 2u);
+    EXPECT_EQ(analytics.Frequency(10), 2u);
+    EXPECT_EQ(analytics.Frequency(60), 0u);
+    EXPECT_EQ(analytics.PairCount(1, 2), 2u);
+    EXPECT_EQ(analytics.PairCount(12, 10), 1u);
+    EXPECT_EQ(analytics.PairCount(3, 50), 0u);
+
+    // Clean up temporary file
+    std::remove(tmpPath.c_str());
+}
+
+TEST(PlayAnalyticsTest, ValidatingAnalyticsTimeWith1MPlays) {
+    PlayersInfo data = createTestData(1'000'000, 5);
+    PlayAnalytics analytics;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    analytics.Update(data);
+    auto updated = std::chrono::high_resolution_clock::now();
+    std::vector<uint64_t> matrix = analytics.PairMatrix();
+    auto queried = std::chrono::high_resolution_clock::now();
+
+    auto updateUs = std::chrono::duration_cast<std::chrono::microseconds>(updated - start).count();
+    auto queryUs = std::chrono::duration_cast<std::chrono::microseconds>(queried - updated).count();
+    std::cout << "Analytics for 1 million plays: update (" << updateUs << " us) "
+              << "full-table query (" << queryUs << " us)" << std::endl;
+    EXPECT_EQ(matrix.size(), 3600u);
+    EXPECT_LT(queryUs, 1'000); // Expect the full-table query to be under a millisecond
+}
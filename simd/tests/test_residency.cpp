@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../src/residency.h"
+#include "test_data.h"
+
+static std::vector<std::pair<const char*, size_t>> arrays(const PlayersInfo& data) {
+    return {{reinterpret_cast<const char*>(data.player_id.data()), data.player_id.size() * sizeof(uint64_t)},
+            {reinterpret_cast<const char*>(data.play_mask.data()), data.play_mask.size() * sizeof(uint64_t)}};
+}
+
+/*
+ * Puts a freshly loaded dataset in the coldest state this host allows before its first draw:
+ * its pages are handed to reclaim (MADV_PAGEOUT, which only takes anonymous pages out when
+ * swap is configured), the arrays are evicted from every cache level and the TLB is refilled
+ * with the pages of an unrelated buffer. Returns the fraction of the pages still resident.
+ */
+static double makeCold(const PlayersInfo& data, std::vector<char>& tlbScratch) {
+    const size_t pageSize = ::sysconf(_SC_PAGESIZE);
+    size_t pages = 0;
+    size_t resident = 0;
+    for (const auto& array : arrays(data)) {
+        char* begin = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(array.first) & ~(pageSize - 1));
+        const size_t size = array.first + array.second - begin;
+        ::madvise(begin, size, MADV_PAGEOUT);
+
+        for (size_t offset = 0; offset < array.second; offset += 64) {
+            _mm_clflush(array.first + offset);
+        }
+
+        std::vector<unsigned char> residency((size + pageSize - 1) / pageSize);
+        if (::mincore(begin, size, residency.data()) == 0) {
+            for (unsigned char page : residency) {
+                resident += page & 1;
+            }
+        }
+        pages += residency.size();
+    }
+
+    for (size_t offset = 0; offset < tlbScratch.size(); offset += pageSize) {
+        tlbScratch[offset]++;
+    }
+    _mm_mfence();
+    return pages == 0 ? 1.0 : static_cast<double>(resident) / pages;
+}
+
+static uint64_t timeCount(LotteryProcessor& lp, const PlayersInfo& data, uint64_t pickedNumMask) {
+    auto start = std::chrono::high_resolution_clock::now();
+    lp.Count(data, pickedNumMask);
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+TEST(ResidencyTest, ReportsDatasetResident) {
+    PlayersInfo data = createTestData(100'000, 3);
+    LotteryProcessor lp;
+
+    Residency::Options options;
+    options.lock = false;
+    Residency::Report report = Residency::MakeResident(data, lp, options);
+
+    EXPECT_GE(report.bytes, data.play_mask.size() * sizeof(uint64_t) * 2);
+    EXPECT_TRUE(report.FullyResident());
+    EXPECT_FALSE(report.locked);
+    EXPECT_EQ(report.attempts, 1u);
+
+    // Locking may be refused by RLIMIT_MEMLOCK, residency must be reported either way
+    options.lock = true;
+    testing::internal::CaptureStdout();
+    report = Residency::MakeResident(data, lp, options);
+    testing::internal::GetCapturedStdout();
+    EXPECT_TRUE(report.FullyResident());
+    Residency::Release(data);
+}
+
+TEST(ResidencyTest, ValidatingFirstCallLatencyWith1MPlays) {
+    LotteryProcessor lp;
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+
+    // 64 MiB touched one byte per page covers far more pages than any TLB holds
+    std::vector<char> tlbScratch(64 << 20, 1);
+
+    // Every trial loads a new dataset into fresh allocations, so nothing carries over
+    std::vector<uint64_t> coldTimes;
+    std::vector<uint64_t> residentTimes;
+    double residentFraction = 0;
+    for (size_t trial = 0; trial < 15; ++trial) {
+        PlayersInfo cold = createTestData(1'000'000, 3 + trial);
+        residentFraction += makeCold(cold, tlbScratch) / 15;
+        coldTimes.emplace_back(timeCount(lp, cold, pickedNumMask));
+
+        PlayersInfo warmed = createTestData(1'000'000, 3 + trial);
+        makeCold(warmed, tlbScratch);
+        testing::internal::CaptureStdout();
+        Residency::MakeResident(warmed, lp, Residency::Options());
+        testing::internal::GetCapturedStdout();
+        residentTimes.emplace_back(timeCount(lp, warmed, pickedNumMask));
+        Residency::Release(warmed);
+    }
+
+    PlayersInfo data = createTestData(1'000'000, 3);
+    std::vector<uint64_t> steadyTimes;
+    for (size_t i = 0; i < 200; ++i) {
+        steadyTimes.emplace_back(timeCount(lp, data, pickedNumMask));
+    }
+
+    std::sort(coldTimes.begin(), coldTimes.end());
+    std::sort(residentTimes.begin(), residentTimes.end());
+    std::sort(steadyTimes.begin(), steadyTimes.end());
+
+    std::cout << "First call for 1 million plays (cold, " << residentFraction * 100 << "% of pages resident): p50 ("
+              << coldTimes[coldTimes.size() / 2] << " us)" << std::endl;
+    std::cout << "First call for 1 million plays (resident): p50 (" << residentTimes[residentTimes.size() / 2] << " us)" << std::endl;
+    std::cout << "Steady state for 1 million plays: p50 (" << steadyTimes[steadyTimes.size() / 2] << " us)" << std::endl;
+    EXPECT_LT(residentTimes[residentTimes.size() / 2], 10'000); // Expect the first draw to be under 10 milliseconds
+}
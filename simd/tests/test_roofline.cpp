@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+
+#include "../src/roofline.h"
+#include "test_data.h"
+
+TEST(RooflineTest, MeasuresReadBandwidth) {
+    Roofline::Options options;
+    options.bufferBytes = 64 << 20;
+    options.runs = 3;
+    Roofline roofline(options);
+
+    EXPECT_GT(roofline.MeasureReadBandwidth(1), 0.0);
+    EXPECT_GT(roofline.MeasureReadBandwidth(2), 0.0);
+}
+
+TEST(RooflineTest, ReportsAFailedBufferAllocation) {
+    Roofline::Options options;
+    options.bufferBytes = 1ull << 62;
+    Roofline roofline(options);
+
+    EXPECT_EQ(roofline.MeasureReadBandwidth(1), 0.0);
+    EXPECT_TRUE(roofline.Run(createTestData(1'000, 71)).empty());
+}
+
+TEST(RooflineTest, ReportsEveryKernelAgainstTheRooflineWith8MPlays) {
+    PlayersInfo data = createTestData(8'000'000, 67);
+    Roofline::Options options;
+    options.bufferBytes = 256 << 20;
+    options.runs = 5;
+    options.prefetchDistances = {128, 512, 2048};
+    Roofline roofline(options);
+
+    std::vector<Roofline::KernelPoint> points = roofline.Run(data);
+    ASSERT_FALSE(points.empty());
+    EXPECT_EQ(points.size() % std::size(LotteryProcessor::Kernels), 0u);
+    for (const auto& point : points) {
+        EXPECT_GT(point.gbPerSec, 0.0);
+        EXPECT_GT(point.rooflineGbPerSec, 0.0);
+    }
+}
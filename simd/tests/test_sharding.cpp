@@ -0,0 +1,391 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <set>
+#include <string>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+
+#include "../src/shard_server.h"
+#include "../src/shard_coordinator.h"
+#include "../src/lottery_input_reader.h"
+#include "test_data.h"
+
+// Runs shardCount shard servers on localhost, one thread each, standing in for the shard processes
+class LocalShards {
+public:
+    LocalShards(const PlayersInfo& data, size_t shardCount, const LotteryProcessor::Config& config = LotteryProcessor::Config()) {
+        for (size_t s = 0; s < shardCount; ++s) {
+            m_shards.emplace_back(new PlayersInfo(SplitByPlayerIdRange(data, s, shardCount)));
+            m_socketPaths.emplace_back("/tmp/lottery_shard_test_" + std::to_string(::getpid()) + "_" + std::to_string(s) + ".sock");
+            m_servers.emplace_back(new ShardServer(*m_shards.back(), m_socketPaths.back(), config));
+            m_listening = m_servers.back()->Listen() && m_listening;
+        }
+
+        for (auto& server : m_servers) {
+            ShardServer* ptr = server.get();
+            m_threads.emplace_back([ptr]() { ptr->Serve(); });
+        }
+    }
+
+    ~LocalShards() {
+        ShardCoordinator stopper(m_socketPaths);
+        if (stopper.Connect()) {
+            stopper.Shutdown();
+        }
+        for (auto& th : m_threads) th.join();
+    }
+
+    bool Listening() const { return m_listening; }
+    const std::vector<std::string>& SocketPaths() const { return m_socketPaths; }
+    const ShardServer& Server(size_t shard) const { return *m_servers[shard]; }
+
+private:
+    std::vector<std::unique_ptr<PlayersInfo>> m_shards;
+    std::vector<std::unique_ptr<ShardServer>> m_servers;
+    std::vector<std::string> m_socketPaths;
+    std::vector<std::thread> m_threads;
+    bool m_listening = true;
+};
+
+TEST(ShardingTest, SplitsByPlayerIdRange) {
+    PlayersInfo data = createTestData(10, 7);
+
+    size_t total = 0;
+    uint64_t lastId = 0;
+    for (size_t s = 0; s < 3; ++s) {
+        PlayersInfo shard = SplitByPlayerIdRange(data, s, 3);
+        for (uint64_t id : shard.player_id) {
+            EXPECT_GT(id, lastId);
+            lastId = id;
+        }
+        total += shard.player_id.size();
+    }
+
+    EXPECT_EQ(total, data.player_id.size());
+}
+
+TEST(ShardingTest, ReaderLoadsOnlyItsShard) {
+    std::string tmpPath = "/tmp/shard_reader_test_" + std::to_string(::getpid()) + ".txt";
+    PlayersInfo data = createTestData(1'000, 7, 100);
+
+    // Plain plays, an invalid line, then system tickets
+    std::ofstream ofs(tmpPath);
+    ASSERT_TRUE(ofs.is_open());
+    std::vector<const std::vector<uint64_t>*> masks = {&data.play_mask, &data.system.play_mask};
+    for (size_t m = 0; m < masks.size(); ++m) {
+        if (m == 1) {
+            ofs << "1 2 3" << std::endl;
+        }
+        for (uint64_t mask : *masks[m]) {
+            for (int number = 1; number <= 60; ++number) {
+                if ((mask >> number) & 1) ofs << number << " ";
+            }
+            ofs << std::endl;
+        }
+    }
+    ofs.close();
+
+    LotteryInputReader fullReader(tmpPath);
+    testing::internal::CaptureStdout();
+    ASSERT_TRUE(fullReader.Read(false));
+    testing::internal::GetCapturedStdout();
+
+    for (size_t shardCount : {1, 3, 7}) {
+        size_t plays = 0;
+        for (size_t s = 0; s < shardCount; ++s) {
+            PlayersInfo expected = SplitByPlayerIdRange(fullReader.GetData(), s, shardCount);
+            LotteryInputReader reader(tmpPath);
+            reader.SetShard(s, shardCount);
+            testing::internal::CaptureStdout();
+            ASSERT_TRUE(reader.Read(false));
+            testing::internal::GetCapturedStdout();
+
+            const PlayersInfo& shard = reader.GetData();
+            EXPECT_EQ(shard.player_id, expected.player_id);
+            EXPECT_EQ(shard.play_mask, expected.play_mask);
+            EXPECT_EQ(shard.system.player_id, expected.system.player_id);
+            EXPECT_EQ(shard.system.play_mask, expected.system.play_mask);
+            plays += shard.player_id.size() + shard.system.player_id.size();
+        }
+        EXPECT_EQ(plays, 1'100u);
+    }
+
+    std::remove(tmpPath.c_str());
+}
+
+TEST(ShardingTest, MergedResultMatchesSingleProcess) {
+    PlayersInfo data = createTestData(100'000, 7);
+    LotteryProcessor lp;
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+    LotteryProcessor::DrawResult expected = lp.Count(data, pickedNumMask);
+    std::vector<uint64_t> expectedWinners;
+    lp.CollectWinners(data, pickedNumMask, 4, expectedWinners);
+
+    LocalShards shards(data, 4);
+    ASSERT_TRUE(shards.Listening());
+
+    ShardCoordinator coordinator(shards.SocketPaths());
+    ASSERT_TRUE(coordinator.Connect());
+
+    // The repeated draw is answered from each shard's cache
+    for (int repeat = 0; repeat < 2; ++repeat) {
+        LotteryProcessor::DrawResult result;
+        std::vector<uint64_t> winners;
+        ASSERT_TRUE(coordinator.Draw(pickedNumMask, 4, result, winners));
+
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], expected.winners[n]);
+        }
+        EXPECT_EQ(winners, expectedWinners);
+    }
+
+    for (size_t s = 0; s < 4; ++s) {
+        EXPECT_EQ(shards.Server(s).GetCacheStats().misses, 1u);
+        EXPECT_EQ(shards.Server(s).GetCacheStats().hits, 1u);
+    }
+}
+
+TEST(ShardingTest, RejectsInvalidDrawMasks) {
+    PlayersInfo data = createTestData(10'000, 7, 1'000);
+    LocalShards shards(data, 1);
+    ASSERT_TRUE(shards.Listening());
+
+    uint64_t wideMask = 0;
+    Utils::SetPlayToMask({1, 2, 3, 4, 5, 6, 7, 8, 9, 10}, wideMask);
+
+    // The coordinator refuses to send it...
+    {
+        ShardCoordinator coordinator(shards.SocketPaths());
+        ASSERT_TRUE(coordinator.Connect());
+        LotteryProcessor::DrawResult result;
+        std::vector<uint64_t> winners;
+        testing::internal::CaptureStdout();
+        EXPECT_FALSE(coordinator.Draw(wideMask, 4, result, winners));
+        testing::internal::GetCapturedStdout();
+    }
+
+    // ...and a shard drops a client that sends it anyway
+    sockaddr_un address;
+    ASSERT_TRUE(ShardProtocol::FillAddress(shards.SocketPaths()[0], address));
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    ShardProtocol::ShardRequest request;
+    request.pickedNumMask = wideMask;
+    testing::internal::CaptureStdout();
+    ASSERT_TRUE(ShardProtocol::WriteAll(fd, &request, sizeof(request)));
+    ShardProtocol::ShardResponse response;
+    EXPECT_FALSE(ShardProtocol::ReadAll(fd, &response, sizeof(response)));
+    testing::internal::GetCapturedStdout();
+    ::close(fd);
+
+    // The shard keeps serving valid draws
+    ShardCoordinator coordinator(shards.SocketPaths());
+    ASSERT_TRUE(coordinator.Connect());
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+    LotteryProcessor::DrawResult result;
+    std::vector<uint64_t> winners;
+    ASSERT_TRUE(coordinator.Draw(pickedNumMask, 4, result, winners));
+    LotteryProcessor lp;
+    LotteryProcessor::DrawResult expected = lp.Count(data, pickedNumMask);
+    for (int n = 0; n < 6; ++n) {
+        EXPECT_EQ(result.winners[n], expected.winners[n]);
+    }
+}
+
+// Stands in for a shard without plays that hangs up on its first draw and answers every later one
+class FlakyShard {
+public:
+    explicit FlakyShard(const std::string& socketPath) : m_socketPath(socketPath) {
+        sockaddr_un address;
+        m_listening = ShardProtocol::FillAddress(socketPath, address);
+        m_listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        ::unlink(socketPath.c_str());
+        m_listening = m_listening && m_listenFd >= 0 &&
+                      ::bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 &&
+                      ::listen(m_listenFd, 4) == 0;
+        if (m_listening) {
+            m_thread = std::thread([this]() { serve(); });
+        }
+    }
+
+    ~FlakyShard() {
+        if (m_thread.joinable()) m_thread.join();
+        if (m_listenFd >= 0) ::close(m_listenFd);
+        ::unlink(m_socketPath.c_str());
+    }
+
+    bool Listening() const { return m_listening; }
+
+private:
+    void serve() {
+        ShardProtocol::ShardRequest request;
+        int fd = ::accept(m_listenFd, nullptr, nullptr);
+        ShardProtocol::ReadAll(fd, &request, sizeof(request));
+        ::close(fd);
+
+        // Serves the second connection until the coordinator goes away
+        fd = ::accept(m_listenFd, nullptr, nullptr);
+        while (ShardProtocol::ReadAll(fd, &request, sizeof(request)) && request.command == ShardProtocol::Draw) {
+            ShardProtocol::ShardResponse response;
+            if (!ShardProtocol::WriteAll(fd, &response, sizeof(response))) break;
+        }
+        ::close(fd);
+    }
+
+    std::string m_socketPath;
+    int m_listenFd = -1;
+    bool m_listening = false;
+    std::thread m_thread;
+};
+
+TEST(ShardingTest, FailedDrawNeverLeavesStaleResponses) {
+    PlayersInfo data = createTestData(10'000, 7, 1'000);
+    LocalShards shards(data, 1);
+    ASSERT_TRUE(shards.Listening());
+
+    // The flaky shard comes first, so the healthy shard's answer is still unread when it fails
+    const std::string flakyPath = "/tmp/lottery_shard_test_" + std::to_string(::getpid()) + "_flaky.sock";
+    FlakyShard flaky(flakyPath);
+    ASSERT_TRUE(flaky.Listening());
+    {
+        ShardCoordinator coordinator({flakyPath, shards.SocketPaths()[0]});
+        ASSERT_TRUE(coordinator.Connect());
+
+        std::mt19937 rng(17);
+        LotteryProcessor::DrawResult result;
+        std::vector<uint64_t> winners;
+        testing::internal::CaptureStdout();
+        EXPECT_FALSE(coordinator.Draw(randomDraw(rng), 2, result, winners));
+        EXPECT_FALSE(coordinator.Draw(randomDraw(rng), 2, result, winners)); // needs a new Connect
+        testing::internal::GetCapturedStdout();
+
+        // After reconnecting, the answer belongs to this draw, not the failed one
+        ASSERT_TRUE(coordinator.Connect());
+        const uint64_t pickedNumMask = randomDraw(rng);
+        ASSERT_TRUE(coordinator.Draw(pickedNumMask, 2, result, winners));
+        LotteryProcessor lp;
+        LotteryProcessor::DrawResult expected = lp.Count(data, pickedNumMask);
+        std::vector<uint64_t> expectedWinners;
+        lp.CollectWinners(data, pickedNumMask, 2, expectedWinners);
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], expected.winners[n]);
+        }
+        EXPECT_EQ(winners, expectedWinners);
+    }
+}
+
+TEST(ShardingTest, RejectsInvalidMinimumWinnerMatches) {
+    PlayersInfo data = createTestData(10'000, 7);
+    LocalShards shards(data, 1);
+    ASSERT_TRUE(shards.Listening());
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+
+    // The coordinator refuses to send one...
+    {
+        ShardCoordinator coordinator(shards.SocketPaths());
+        ASSERT_TRUE(coordinator.Connect());
+        LotteryProcessor::DrawResult result;
+        std::vector<uint64_t> winners;
+        testing::internal::CaptureStdout();
+        EXPECT_FALSE(coordinator.Draw(pickedNumMask, 0, result, winners));
+        EXPECT_FALSE(coordinator.Draw(pickedNumMask, 6, result, winners));
+        testing::internal::GetCapturedStdout();
+    }
+
+    // ...and a shard drops a client that sends one anyway
+    for (uint32_t minWinnerMatches : {0u, 6u, UINT32_MAX}) {
+        sockaddr_un address;
+        ASSERT_TRUE(ShardProtocol::FillAddress(shards.SocketPaths()[0], address));
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        ShardProtocol::ShardRequest request;
+        request.pickedNumMask = pickedNumMask;
+        request.minWinnerMatches = minWinnerMatches;
+        testing::internal::CaptureStdout();
+        ASSERT_TRUE(ShardProtocol::WriteAll(fd, &request, sizeof(request)));
+        ShardProtocol::ShardResponse response;
+        EXPECT_FALSE(ShardProtocol::ReadAll(fd, &response, sizeof(response)));
+        testing::internal::GetCapturedStdout();
+        ::close(fd);
+    }
+}
+
+TEST(ShardingTest, ValidatingShardingOverheadWith1MPlays) {
+    PlayersInfo data = createTestData(1'000'000, 7);
+    const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+
+    // A different draw every time, so the shard caches do not flatter the sharded timings
+    std::mt19937 rng(13);
+    std::vector<uint64_t> draws;
+    for (size_t i = 0; i < 200; ++i) {
+        draws.emplace_back(randomDraw(rng));
+    }
+
+    // Count and CollectWinners each read play_mask once per draw
+    const double bytesPerDraw = 2.0 * data.play_mask.size() * sizeof(uint64_t);
+    auto report = [&](const std::string& label, std::vector<uint64_t>& perfTimes) {
+        std::sort(perfTimes.begin(), perfTimes.end());
+        uint64_t percentile50 = perfTimes.size() * 50 / 100;
+        uint64_t percentile90 = perfTimes.size() * 90 / 100;
+        std::cout << "Processing time for 1 million plays (" << label << "): "
+                  << "p50 (" << perfTimes[percentile50] << " us) "
+                  << "p90 (" << perfTimes[percentile90] << " us), "
+                  << "play_mask scanned at p50 (" << bytesPerDraw / std::max<uint64_t>(1, perfTimes[percentile50]) / 1e3
+                  << " GB/s)" << std::endl;
+        return perfTimes[percentile90];
+    };
+
+    LotteryProcessor lp;
+    std::vector<uint64_t> perfTimes;
+    for (size_t i = 0; i < 200; ++i) {
+        std::vector<uint64_t> winners;
+        auto start = std::chrono::high_resolution_clock::now();
+        lp.Count(data, draws[i]);
+        lp.CollectWinners(data, draws[i], 4, winners);
+        auto end = std::chrono::high_resolution_clock::now();
+        perfTimes.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    }
+    report("single process, " + std::to_string(cores) + " threads", perfTimes);
+
+    // Powers of two up to the core count and beyond; each shard gets its share of the cores,
+    // so the aggregate GB/s stops growing once memory bandwidth (or the cores) run out
+    std::set<size_t> shardCounts = {1, 2, 4, cores};
+    for (size_t count = 1; count <= cores; count <<= 1) {
+        shardCounts.insert(count);
+    }
+
+    for (size_t shardCount : shardCounts) {
+        LotteryProcessor::Config config;
+        config.threads = std::max<unsigned int>(1, cores / shardCount);
+        LocalShards shards(data, shardCount, config);
+        ASSERT_TRUE(shards.Listening());
+        ShardCoordinator coordinator(shards.SocketPaths());
+        ASSERT_TRUE(coordinator.Connect());
+
+        perfTimes.clear();
+        for (size_t i = 0; i < 200; ++i) {
+            LotteryProcessor::DrawResult result;
+            std::vector<uint64_t> winners;
+            auto start = std::chrono::high_resolution_clock::now();
+            ASSERT_TRUE(coordinator.Draw(draws[i], 4, result, winners));
+            auto end = std::chrono::high_resolution_clock::now();
+            perfTimes.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        }
+
+        uint64_t p90 = report(std::to_string(shardCount) + " shards x " + std::to_string(config.threads) + " threads", perfTimes);
+        EXPECT_LT(p90, 100'000);
+    }
+}
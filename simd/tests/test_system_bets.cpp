@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "../src/lottery_processor.h"
+#include "../src/ticket_cancellation.h"
+#include "../src/liability_sweep.h"
+#include "../src/shard_server.h"
+#include "test_data.h"
+
+static const std::vector<std::vector<int>> testDraws = {
+    {1, 11, 22, 50, 60}, {2, 3, 5, 7, 11}, {40, 41, 42, 43, 44}, {1, 2, 3, 4, 5}};
+
+TEST(SystemBetsTest, TierTableCoversEveryCombination) {
+    for (int n = 6; n <= 10; ++n) {
+        for (int m = 0; m <= 5; ++m) {
+            int total = 0;
+            for (int k = 0; k <= 5; ++k) {
+                total += SystemTiers.count[n][m][k];
+            }
+            EXPECT_EQ(total, Utils::Binomial(n, 5)) << "n=" << n << " m=" << m;
+        }
+    }
+
+    // 10 numbers, all 5 drawn: one jackpot, C(5,4)*C(5,1) = 25 fours and the 5 others make one blank
+    EXPECT_EQ(SystemTiers.count[10][5][5], 1);
+    EXPECT_EQ(SystemTiers.count[10][5][4], 25);
+    EXPECT_EQ(SystemTiers.count[10][5][0], 1);
+}
+
+TEST(SystemBetsTest, CountsMatchExpandedCombinations) {
+    PlayersInfo data = createTestData(20'000, 31, 3'000);
+    TicketCancellation::Cancel(data, {7, 20'005, 20'100});
+    EXPECT_EQ(data.cancelled, 1u);
+    EXPECT_EQ(data.system.cancelled, 2u);
+
+    PlayersInfo expanded = expandSystemPlays(data);
+    for (auto kernel : LotteryProcessor::Kernels) {
+        for (unsigned int threads : {1u, 3u}) {
+            for (size_t chunkSize : {0, 1000}) {
+                LotteryProcessor::Config config;
+                config.threads = threads;
+                config.chunkSize = chunkSize;
+                config.kernel = kernel;
+                LotteryProcessor lp(config);
+
+                for (const auto& draw : testDraws) {
+                    uint64_t pickedNumMask = 0;
+                    Utils::SetPlayToMask(draw, pickedNumMask);
+                    LotteryProcessor::DrawResult result = lp.Count(data, pickedNumMask);
+                    LotteryProcessor::DrawResult expected = lp.Count(expanded, pickedNumMask);
+                    for (int n = 0; n < 6; ++n) {
+                        EXPECT_EQ(result.winners[n], expected.winners[n]) << LotteryProcessor::KernelName(kernel)
+                            << " threads=" << threads << " chunk=" << chunkSize;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(SystemBetsTest, RejectsDrawMasksWiderThanFiveNumbers) {
+    PlayersInfo data = createTestData(1'000, 31, 300);
+    LotteryProcessor lp;
+
+    // Six or more drawn numbers would give system tickets (and plays) more than 5 matches
+    uint64_t wideMask = 0;
+    Utils::SetPlayToMask({1, 2, 3, 4, 5, 6, 7, 8, 9, 10}, wideMask);
+    for (uint64_t mask : std::vector<uint64_t>{wideMask, 1, 1ULL << 61}) {
+        EXPECT_FALSE(Utils::ValidateDrawMask(mask));
+        testing::internal::CaptureStdout();
+        LotteryProcessor::DrawResult result = lp.Count(data, mask);
+        LotteryProcessor::DrawResult range = lp.CountRange(data, 0, data.play_mask.size(), 0, data.system.play_mask.size(), mask);
+        testing::internal::GetCapturedStdout();
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], 0);
+            EXPECT_EQ(range.winners[n], 0);
+        }
+    }
+
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 60}, pickedNumMask);
+    EXPECT_TRUE(Utils::ValidateDrawMask(pickedNumMask));
+}
+
+TEST(SystemBetsTest, CollectsWinnersOncePerTicketInOrder) {
+    PlayersInfo data = createTestData(20'000, 31, 3'000);
+    // Interleave the ID ranges: system tickets get odd IDs, plain plays even ones
+    for (size_t i = 0; i < data.player_id.size(); ++i) {
+        data.player_id[i] = 2 * (i + 1);
+    }
+    for (size_t i = 0; i < data.system.player_id.size(); ++i) {
+        data.system.player_id[i] = 2 * i + 1;
+    }
+
+    PlayersInfo expanded = expandSystemPlays(data);
+    LotteryProcessor lp;
+    for (const auto& draw : testDraws) {
+        uint64_t pickedNumMask = 0;
+        Utils::SetPlayToMask(draw, pickedNumMask);
+
+        std::vector<uint64_t> winners;
+        lp.CollectWinners(data, pickedNumMask, 3, winners);
+        EXPECT_TRUE(std::is_sorted(winners.begin(), winners.end()));
+
+        std::vector<uint64_t> expected;
+        lp.CollectWinners(expanded, pickedNumMask, 3, expected);
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        EXPECT_EQ(winners, expected);
+    }
+}
+
+TEST(SystemBetsTest, CompactionAndShardsKeepSystemPlays) {
+    PlayersInfo data = createTestData(10'000, 31, 2'000);
+    TicketCancellation::Cancel(data, {3, 10'010, 10'020});
+
+    PlayersInfo compacted = TicketCancellation::Compact(data);
+    EXPECT_EQ(compacted.system.player_id.size(), 1'998u);
+    EXPECT_EQ(compacted.system.cancelled, 0u);
+
+    LotteryProcessor lp;
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 2, 3, 4, 5}, pickedNumMask);
+    LotteryProcessor::DrawResult expected = lp.Count(data, pickedNumMask);
+    LotteryProcessor::DrawResult result = lp.Count(compacted, pickedNumMask);
+
+    LotteryProcessor::DrawResult sharded;
+    for (size_t shard = 0; shard < 3; ++shard) {
+        LotteryProcessor::DrawResult partial = lp.Count(SplitByPlayerIdRange(data, shard, 3), pickedNumMask);
+        for (int n = 0; n < 6; ++n) {
+            sharded.winners[n] += partial.winners[n];
+        }
+    }
+
+    for (int n = 0; n < 6; ++n) {
+        EXPECT_EQ(result.winners[n], expected.winners[n]);
+        EXPECT_EQ(sharded.winners[n], expected.winners[n]);
+    }
+}
+
+TEST(SystemBetsTest, LiabilitySweepWeighsSystemPlays) {
+    PlayersInfo data = createTestData(5'000, 31, 1'000);
+    TicketCancellation::Cancel(data, {5'001});
+
+    LiabilitySweep sweep;
+    sweep.Aggregate(data);
+    LotteryProcessor lp;
+
+    std::mt19937 rng(37);
+    std::uniform_int_distribution<uint64_t> ranks(0, sweep.DrawCount() - 1);
+    for (int i = 0; i < 100; ++i) {
+        const uint64_t drawMask = sweep.DrawMask(ranks(rng));
+        LotteryProcessor::DrawResult expected = lp.Count(data, drawMask);
+        LotteryProcessor::DrawResult result = sweep.Evaluate(drawMask);
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], expected.winners[n]) << "draw mask " << drawMask;
+        }
+    }
+}
+
+TEST(SystemBetsTest, ValidatingProcessingTimeWith1MPlaysAnd100KSystemPlays) {
+    PlayersInfo data = createTestData(1'000'000, 31, 100'000);
+
+    LotteryProcessor lp;
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+
+    std::vector<uint64_t> perfTimes;
+    for (size_t i = 0; i < 500; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        lp.Count(data, pickedNumMask);
+        auto end = std::chrono::high_resolution_clock::now();
+        perfTimes.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    }
+
+    std::sort(perfTimes.begin(), perfTimes.end());
+    uint64_t percentile50 = perfTimes.size() * 50 / 100;
+    uint64_t percentile90 = perfTimes.size() * 90 / 100;
+
+    std::cout << "Processing time for 1 million plays and 100k system plays: "
+              << "p50 (" << perfTimes[percentile50] << " us) "
+              << "p90 (" << perfTimes[percentile90] << " us)" << std::endl;
+    EXPECT_LT(perfTimes[percentile90], 10'000); // Expect processing to be under 10 milliseconds
+}
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "../src/ticket_cancellation.h"
+#include "../src/lottery_processor.h"
+#include "test_data.h"
+
+// Rebuilds the dataset from scratch without the cancelled IDs, the reference for exactness
+static PlayersInfo rebuildWithout(const PlayersInfo& data, const std::set<uint64_t>& cancelled) {
+    PlayersInfo rebuilt;
+    for (size_t i = 0; i < data.player_id.size(); ++i) {
+        if (cancelled.count(data.player_id[i]) == 0) {
+            rebuilt.player_id.emplace_back(data.player_id[i]);
+            rebuilt.play_mask.emplace_back(data.play_mask[i]);
+        }
+    }
+    return rebuilt;
+}
+
+static std::vector<uint64_t> randomIds(size_t count, size_t maxId, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint64_t> dist(1, maxId);
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < count; ++i) {
+        ids.emplace_back(dist(rng));
+    }
+    return ids;
+}
+
+static void expectSameResults(const PlayersInfo& data, const PlayersInfo& reference, const LotteryProcessor::Config& config) {
+    LotteryProcessor lp(config);
+    for (const auto& draw : std::vector<std::vector<int>>{{1, 11, 22, 50, 60}, {2, 3, 5, 7, 11}, {40, 41, 42, 43, 44}}) {
+        uint64_t pickedNumMask = 0;
+        Utils::SetPlayToMask(draw, pickedNumMask);
+        LotteryProcessor::DrawResult result = lp.Count(data, pickedNumMask);
+        LotteryProcessor::DrawResult expected = lp.Count(reference, pickedNumMask);
+        for (int n = 0; n < 6; ++n) {
+            EXPECT_EQ(result.winners[n], expected.winners[n]) << LotteryProcessor::KernelName(config.kernel)
+                << " threads=" << config.threads << " chunk=" << config.chunkSize;
+        }
+
+        std::vector<uint64_t> winners;
+        std::vector<uint64_t> expectedWinners;
+        lp.CollectWinners(data, pickedNumMask, 3, winners);
+        lp.CollectWinners(reference, pickedNumMask, 3, expectedWinners);
+        EXPECT_EQ(winners, expectedWinners);
+    }
+}
+
+TEST(TicketCancellationTest, CancelsByPlayerId) {
+    PlayersInfo data = createTestData(100, 17);
+    const uint64_t loadedEpoch = data.epoch;
+
+    EXPECT_EQ(TicketCancellation::Cancel(data, {5, 64, 65, 5, 1000}), 3u);
+    EXPECT_EQ(data.cancelled, 3u);
+    EXPECT_NE(data.epoch, loadedEpoch);
+    const uint64_t cancelledEpoch = data.epoch;
+    EXPECT_TRUE(Utils::IsCancelled(data, 4));
+    EXPECT_TRUE(Utils::IsCancelled(data, 63));
+    EXPECT_TRUE(Utils::IsCancelled(data, 64));
+    EXPECT_FALSE(Utils::IsCancelled(data, 5));
+
+    // Nothing new cancelled, so the dataset did not change
+    EXPECT_EQ(TicketCancellation::Cancel(data, {5, 1000}), 0u);
+    EXPECT_EQ(data.epoch, cancelledEpoch);
+}
+
+TEST(TicketCancellationTest, ResultsMatchRebuiltDataset) {
+    PlayersInfo data = createTestData(100'003, 17);
+    std::vector<uint64_t> ids = randomIds(10'000, data.player_id.size(), 1);
+    TicketCancellation::Cancel(data, ids);
+
+    PlayersInfo reference = rebuildWithout(data, std::set<uint64_t>(ids.begin(), ids.end()));
+    ASSERT_EQ(data.player_id.size() - data.cancelled, reference.player_id.size());
+
+    for (auto kernel : LotteryProcessor::Kernels) {
+        for (unsigned int threads : {1u, 3u}) {
+            for (size_t chunkSize : {0, 1000}) {
+                LotteryProcessor::Config config;
+                config.threads = threads;
+                config.chunkSize = chunkSize;
+                config.kernel = kernel;
+                expectSameResults(data, reference, config);
+            }
+        }
+    }
+}
+
+TEST(TicketCancellationTest, BackgroundCompactionKeepsLateCancellations) {
+    PlayersInfo data = createTestData(200'000, 17);
+    std::vector<uint64_t> early = randomIds(30'000, data.player_id.size(), 2);
+    std::vector<uint64_t> late = randomIds(5'000, data.player_id.size(), 3);
+
+    TicketCancellation::Cancel(data, early);
+    BackgroundCompactor compactor;
+    EXPECT_FALSE(compactor.MaybeStart(data, 0.5));
+    ASSERT_TRUE(compactor.MaybeStart(data, 0.1));
+    EXPECT_TRUE(compactor.Pending());
+
+    // Cancellations keep arriving while the compaction runs
+    TicketCancellation::Cancel(data, late);
+    const uint64_t epochBeforePublish = data.epoch;
+    ASSERT_TRUE(compactor.Publish(data));
+    EXPECT_FALSE(compactor.Pending());
+    EXPECT_GT(data.epoch, epochBeforePublish);
+
+    std::set<uint64_t> cancelled(early.begin(), early.end());
+    cancelled.insert(late.begin(), late.end());
+    PlayersInfo reference = rebuildWithout(createTestData(200'000, 17), cancelled);
+
+    // Late cancellations are still tombstoned in the compacted arrays
+    EXPECT_GT(data.cancelled, 0u);
+    EXPECT_EQ(data.player_id.size() - data.cancelled, reference.player_id.size());
+    expectSameResults(data, reference, LotteryProcessor::Config());
+
+    PlayersInfo compacted = TicketCancellation::Compact(data);
+    EXPECT_EQ(compacted.player_id, reference.player_id);
+    EXPECT_EQ(compacted.cancelled, 0u);
+}
+
+TEST(TicketCancellationTest, PollCompactsPeriodicallyWithoutBlocking) {
+    PlayersInfo data = createTestData(200'000, 17);
+    std::vector<uint64_t> ids = randomIds(30'000, data.player_id.size(), 5);
+    BackgroundCompactor compactor;
+
+    // Nothing to compact at the first check, and the next one is an interval away
+    EXPECT_FALSE(compactor.Poll(data, 0.1, std::chrono::hours(1)));
+    TicketCancellation::Cancel(data, ids);
+    EXPECT_FALSE(compactor.Poll(data, 0.1, std::chrono::hours(1)));
+    EXPECT_FALSE(compactor.Pending());
+
+    // Draws keep being served between polls until the compaction is published
+    LotteryProcessor lp;
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+    bool published = false;
+    for (int poll = 0; poll < 100'000 && !published; ++poll) {
+        lp.Count(data, pickedNumMask);
+        published = compactor.Poll(data, 0.1, std::chrono::milliseconds(0));
+    }
+    ASSERT_TRUE(published);
+    EXPECT_FALSE(compactor.Pending());
+
+    PlayersInfo reference = rebuildWithout(createTestData(200'000, 17), std::set<uint64_t>(ids.begin(), ids.end()));
+    EXPECT_EQ(data.player_id, reference.player_id);
+    EXPECT_EQ(data.cancelled, 0u);
+    expectSameResults(data, reference, LotteryProcessor::Config());
+}
+
+TEST(TicketCancellationTest, ValidatingProcessingTimeWith1MPlaysAnd1PercentCancelled) {
+    PlayersInfo data = createTestData(1'000'000, 17);
+    TicketCancellation::Cancel(data, randomIds(10'000, data.player_id.size(), 4));
+
+    LotteryProcessor lp;
+    uint64_t pickedNumMask = 0;
+    Utils::SetPlayToMask({1, 11, 22, 50, 60}, pickedNumMask);
+
+    std::vector<uint64_t> perfTimes;
+    for (size_t i = 0; i < 500; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        lp.Count(data, pickedNumMask);
+        auto end = std::chrono::high_resolution_clock::now();
+        perfTimes.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    }
+
+    std::sort(perfTimes.begin(), perfTimes.end());
+    uint64_t percentile50 = perfTimes.size() * 50 / 100;
+    uint64_t percentile90 = perfTimes.size() * 90 / 100;
+
+    std::cout << "Processing time for 1 million plays (1% cancelled): "
+              << "p50 (" << perfTimes[percentile50] << " us) "
+              << "p90 (" << perfTimes[percentile90] << " us)" << std::endl;
+    EXPECT_LT(perfTimes[percentile90], 10'000); // Expect processing to be under 10 milliseconds
+}
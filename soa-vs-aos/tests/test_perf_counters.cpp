@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+
+#include "../src/perf_counters.h"
+#include "../src/lottery_processor.h"
+
+TEST(PerfCountersTest, ReportsPerPlayCostWith1MPlays) {
+#ifdef ENABLE_SOA
+    PlayersInfo data;
+#else
+    std::vector<PlayerInfo> data;
+#endif
+    const size_t plays = 1'000'000;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> dist(1, 60);
+
+    for (size_t i = 0; i < plays; ++i) {
+        PlayerInfo play;
+        play.player_id = i + 1;
+        play.play_mask = 0;
+        while (__builtin_popcountll(play.play_mask) < 5) {
+            play.play_mask |= (1ULL << dist(rng));
+        }
+#ifdef ENABLE_SOA
+        data.player_id.emplace_back(play.player_id);
+        data.play_mask.emplace_back(play.play_mask);
+#else
+        data.emplace_back(play);
+#endif
+    }
+
+    LotteryProcessor lp;
+    const size_t runs = 50;
+    testing::internal::CaptureStdout();
+    lp.Process(data, {1, 11, 22, 50, 60}); // warm-up
+
+    // Counters wrap exactly the Process calls, worker threads included
+    PerfCounters counters;
+    counters.Start();
+    for (size_t i = 0; i < runs; ++i) {
+        lp.Process(data, {1, 11, 22, 50, 60});
+    }
+    PerfCounters::Sample sample = counters.Stop();
+    testing::internal::GetCapturedStdout();
+
+#ifdef ENABLE_SOA
+    PerfCounters::PrintPerPlay("Structure of Arrays", sample, plays * runs);
+#else
+    PerfCounters::PrintPerPlay("Array of Structures", sample, plays * runs);
+#endif
+}